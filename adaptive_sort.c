@@ -0,0 +1,153 @@
+/*
+ * adaptive_sort.c
+ *
+ *      Adaptive merge sort for presorted data: natural ascending & descending runs are
+ *      detected, descending runs are reversed in place, short runs are extended by insertion
+ *      sort. Runs are merged by powersort policy, so merge tree is nearly balanced and
+ *      sorted or nearly sorted arrays are done in close to linear time.
+ */
+
+#include "sort.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+/*Runs shorter than this are extended by insertion sort*/
+#define MIN_RUN_LEN 32
+/*Powers stack depth, enough for any int array length*/
+#define MAX_RUNS_STACK 64
+
+struct run_t{
+	int begin;
+	int end;
+	int power; //power of boundary between this run and next one
+};
+
+
+static void
+reverse_array( BigArrayPtr array, int array_len ){
+	for ( int i=0, j=array_len-1; i < j; i++, j-- ){
+		BigArrayItem swap = array[i];
+		array[i] = array[j];
+		array[j] = swap;
+	}
+}
+
+/*@return end of run starting at begin, descending run is reversed, short run is extended*/
+static int
+extend_run( BigArrayPtr array, int begin, int array_len ){
+	int end = begin+1;
+	if ( end < array_len && item_less( array[end], array[end-1] ) ){
+		while( end < array_len && item_less( array[end], array[end-1] ) )
+			++end;
+		reverse_array( array+begin, end-begin );
+	}
+	else{
+		while( end < array_len && item_less_equal( array[end-1], array[end] ) )
+			++end;
+	}
+	if ( end-begin < MIN_RUN_LEN ){
+		end = min_len( begin+MIN_RUN_LEN, array_len );
+		insertion_sort( array+begin, end-begin );
+	}
+	return end;
+}
+
+/*Power of node between runs [begin1,end1) & [end1,end2) in nearly optimal merge tree: count
+ *of equal leading bits of runs midpoints taken as binary fractions of array length*/
+static int
+node_power( int begin1, int end1, int end2, int array_len ){
+	/*doubled midpoints*/
+	int64_t a = (int64_t)begin1 + end1;
+	int64_t b = (int64_t)end1 + end2;
+	int power = 0;
+	for(;;){
+		++power;
+		if ( a >= array_len ){
+			a -= array_len;
+			b -= array_len;
+		}
+		else if ( b >= array_len )
+			break;
+		a <<= 1;
+		b <<= 1;
+	}
+	return power;
+}
+
+/*upper bound of item in sorted array*/
+static int
+upper_bound( const BigArrayPtr array, int array_len, BigArrayItem item ){
+	int low = 0, high = array_len;
+	while( low < high ){
+		int middle = low + (high-low)/2;
+		if ( item_less_equal( array[middle], item ) ) low = middle+1;
+		else high = middle;
+	}
+	return low;
+}
+
+static int
+lower_bound( const BigArrayPtr array, int array_len, BigArrayItem item ){
+	int low = 0, high = array_len;
+	while( low < high ){
+		int middle = low + (high-low)/2;
+		if ( item_less( array[middle], item ) ) low = middle+1;
+		else high = middle;
+	}
+	return low;
+}
+
+/*merge adjacent runs [begin,middle) & [middle,end), items already standing on its places are
+ *skipped, left part is moved into scratch and merged back*/
+static void
+merge_runs( BigArrayPtr array, int begin, int middle, int end, BigArrayPtr scratch ){
+	if ( item_less_equal( array[middle-1], array[middle] ) )
+		return;
+	begin += upper_bound( array+begin, middle-begin, array[middle] );
+	end = middle + lower_bound( array+middle, end-middle, array[middle-1] );
+	copy_array( scratch, array+begin, middle-begin );
+	merge_into( array+begin, scratch, middle-begin, array+middle, end-middle );
+}
+
+
+/**Adaptive natural runs merge sort
+ * @param sorted_array caller provided output, array_len items
+ * @param runs_count runs found in array after extension of short runs, 1 if array was sorted*/
+void
+adaptive_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len, int *runs_count ){
+	*runs_count = 0;
+	if ( array_len <= 0 ) return;
+	copy_array( sorted_array, array, array_len );
+	BigArrayPtr scratch = NULL;
+
+	struct run_t stack[MAX_RUNS_STACK];
+	int stack_len = 0;
+	struct run_t run;
+	run.begin = 0;
+	run.end = extend_run( sorted_array, 0, array_len );
+	++*runs_count;
+	while( run.end < array_len ){
+		struct run_t next_run;
+		next_run.begin = run.end;
+		next_run.end = extend_run( sorted_array, next_run.begin, array_len );
+		++*runs_count;
+		if ( !scratch )
+			scratch = malloc( sizeof(BigArrayItem)*array_len );
+
+		int power = node_power( run.begin, run.end, next_run.end, array_len );
+		while( stack_len > 0 && stack[stack_len-1].power > power ){
+			struct run_t *left = &stack[--stack_len];
+			merge_runs( sorted_array, left->begin, run.begin, run.end, scratch );
+			run.begin = left->begin;
+		}
+		run.power = power;
+		stack[stack_len++] = run;
+		run = next_run;
+	}
+	while( stack_len > 0 ){
+		struct run_t *left = &stack[--stack_len];
+		merge_runs( sorted_array, left->begin, run.begin, run.end, scratch );
+		run.begin = left->begin;
+	}
+	free( scratch );
+}
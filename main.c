@@ -10,6 +10,10 @@
  */
 
 #include "sort.h"
+#include "splitter.h"
+#ifdef STRING_KEYS
+#include "string_sort.h"
+#endif
 
 #include <zmq.h>
 #include <sys/types.h>
@@ -21,6 +25,8 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <time.h>
+#include <sys/time.h> //gettimeofday
+#include <pthread.h>
 
 //#define DEBUG
 
@@ -30,29 +36,70 @@
 #define DST_NODES_COUNT SRC_NODES_COUNT
 /*Source data length stored in single source node (process)*/
 #define ARRAY_ITEMS_COUNT 1000000
+/*Local sort engine of source nodes, ESORT_AUTO - selected by autotuner,
+ *ESORT_RECURSIVE_MERGE is old alloc_merge_sort. Destination nodes merge received sorted runs*/
+#define SRC_SORT_ENGINE ESORT_AUTO
+/*Threads count used by source node local sort, 0 - online processors count*/
+#define SRC_SORT_THREADS 0
+/*Threads count of destination merge of whole received ranges, 0 - online processors count*/
+#define DST_MERGE_THREADS 0
+/*Splitters search of fixed size items mode*/
+enum splitter_t { ESPLITTER_HISTOGRAMS, ESPLITTER_BISECTION, ESPLITTER_SAMPLING, ESPLITTER_EPSILON,
+	ESPLITTER_RADIX, ESPLITTER_DECENTRALIZED };
+/*ESPLITTER_HISTOGRAMS - walk of coarse histograms completed by step-1 detailed histograms,
+ *ESPLITTER_BISECTION - coarse histograms bracket splitters, then distributed bisection by rank queries,
+ *ESPLITTER_SAMPLING - single round regular sampling (PSRS): every source sends DST_NODES_COUNT evenly
+ *spaced samples, manager picks splitters (key, source, index) of merged samples and sources cut own
+ *ranges by it.
+ *ESPLITTER_EPSILON - splitters of sampling mode are picked from coarse histograms if it keeps partitions
+ *within SPLITTER_EPSILON, other splitters are refined by rank queries.
+ *ESPLITTER_RADIX - sources count items by RADIX_SPLITTER_BITS digits of key, first round counts top digit,
+ *next rounds count next digit inside boundary buckets only, round per digit: 2 for 32-bit keys, 4 for 64-bit.
+ *ESPLITTER_DECENTRALIZED - sampling mode without manager: every source sends own samples to all sources,
+ *computes the same splitters of all samples and cuts own ranges, manager only sends pids table at start.
+ *Exact modes give equal partitions, sampling, epsilon & decentralized modes partitions are balanced
+ *approximately*/
+#define SPLITTER_MODE ESPLITTER_BISECTION
+/*SPLITTER_EPSILON tolerance & RADIX_SPLITTER_BITS digit width of splitters modes are in splitter.h*/
+/*Query mode: only some keys of sorted data are needed, destinations aren't forked & items aren't exchanged*/
+enum query_t { EQUERY_NONE, EQUERY_QUANTILES, EQUERY_TOP_K };
+/*EQUERY_NONE - distributed sort,
+ *EQUERY_QUANTILES - exact items of QUERY_QUANTILES global quantiles are found by rank queries of sorted sources,
+ *EQUERY_TOP_K - every source sends its QUERY_TOP_K least items, manager merges it & keeps QUERY_TOP_K least*/
+#define QUERY_MODE EQUERY_NONE
+#define QUERY_QUANTILES { 0.5, 0.99 }
+#define QUERY_TOP_K 10
+/*Streaming ranges transfer: sources send ranges by chunks of STREAM_CHUNK_ITEMS items and destinations
+ *merge chunks while receiving, 0 - ranges are sent whole. Argsort mode aligns ranks to whole ranges*/
+#ifndef ARGSORT
+#define STREAM_CHUNK_ITEMS (16*1024)
+#else
+#define STREAM_CHUNK_ITEMS 0
+#endif
+/*Max count of received and not merged chunks per run*/
+#define STREAM_QUEUE_CHUNKS 4
+/*zmq_poll timeout of stream receiver, microseconds for zeromq 2.x*/
+#define STREAM_POLL_TIMEOUT 10000
+/*String keys mode (make string): every source sends each STRING_SAMPLE_STEP string as histogram*/
+#define STRING_SAMPLE_STEP 1000
 /*Identifiers of packets sending beetwen nodes*/
-enum packet_t { EPACKET_UNKNOWN=-1, EPACKET_HISTOGRAM, EPACKET_SEQUENCE_REQUEST, EPACKET_RANGE, EPACKET_PID };
-
-#define max(a,b) \
-  ({ __typeof__ (a) _a = (a); \
-      __typeof__ (b) _b = (b); \
-    _a > _b ? _a : _b; })
-
-#define min(a,b) \
-  ({ __typeof__ (a) _a = (a); \
-      __typeof__ (b) _b = (b); \
-    _a < _b ? _a : _b; })
-
+enum packet_t { EPACKET_UNKNOWN=-1, EPACKET_HISTOGRAM, EPACKET_SEQUENCE_REQUEST, EPACKET_RANGE, EPACKET_PID,
+	EPACKET_SPLITTERS, EPACKET_RANK_OFFSET, EPACKET_RANKS };
+
+/*Argsort mode (make argsort): instead of sorted data every source gets global rank
+ *of each item of its unsorted array*/
+#if ARRAY_ITEMS_COUNT*SRC_NODES_COUNT > 0xFFFFFFFF
+typedef uint64_t GlobalRank;
+#else
+typedef uint32_t GlobalRank;
+#endif
 
-struct node_pid_t{
-	pid_t src_node_pid;
-	pid_t dst_node_pid;
-};
 
 struct sort_result{
 	pid_t pid;
-	BigArrayItem min;
-	BigArrayItem max;
+	int len; //items count of destination partition
+	SortKey min; //key of least item
+	SortKey max;
 	uint32_t crc;
 };
 
@@ -64,34 +111,31 @@ struct packet_data_t{
 };
 
 
-struct Histogram{
-	pid_t src_pid;
-	size_t array_len;
-	HistogramArrayPtr array;
-};
-
-
-struct request_data_t{
-	int first_item_index;
-	int last_item_index;
-	pid_t src_pid;
-	pid_t dst_pid;
+/*Bounded queue of received chunks of one sorted run, head chunk is merged currently*/
+struct stream_run_t{
+	zmq_msg_t chunks[STREAM_QUEUE_CHUNKS]; //received messages are merged in place, closed after merge
+	int first; //index of head chunk
+	int count; //chunks count in queue
+	int finished; //last chunk of run received
 };
 
-struct histogram_helper_t{
-	int begin_offset;
-	int begin_histogram_index; //First histogram in range
-	int end_histogram_index; //Last histogram in range
-	int begin_detailed_histogram_index; //First histogram in range
-	int end_detailed_histogram_index; //Last histogram in range
+/*Shared by receiver thread & merging thread of destination node*/
+struct stream_t{
+	void *context;
+	int runs_count;
+	const pid_t *src_pids;
+	struct stream_run_t *runs;
+	double last_chunk_time;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
 };
 
-
-struct histogram_worker{
-	struct Histogram histogram;
-	struct Histogram detailed_histogram;
-	struct histogram_helper_t helper;
-	int current_histogram_complete;
+/*Sorted array of source shared by zero-copy messages of its ranges, array is freed by last reference,
+ *zeromq releases reference of message from its I/O thread*/
+struct shared_array_t{
+	BigArrayPtr array;
+	int refcount;
+	pthread_mutex_t lock;
 };
 
 
@@ -99,321 +143,13 @@ struct histogram_worker{
 int
 channel_recv_detailed_histograms_request(void *context, const BigArrayPtr source_array, int array_len);
 
-/*@param complete Flag 0 say to client in request that would be requested again, 1-last request send
- *return Histogram Caller is responsive to free memory after using result*/
-struct Histogram*
-channel_request_response_detailed_histograms_alloc_get_len(void *context, const struct request_data_t* request_data,
-		int request_array_len, int complete );
-
-
-void
-init_worker( struct histogram_worker* worker ){
-	worker->detailed_histogram.array = NULL;
-	worker->helper.begin_histogram_index = 0;
-	worker->helper.end_histogram_index = 0;
-	worker->helper.begin_detailed_histogram_index = 0;
-	worker->helper.end_detailed_histogram_index = 0;
-	worker->helper.begin_offset = 0;
-	worker->current_histogram_complete = 0;
-}
-
-
-void
-check_remove_detailed_histogram( struct histogram_worker* worker ){
-	if ( worker->detailed_histogram.array ){
-		HistogramArrayItem current_item = worker->detailed_histogram.array[worker->helper.end_detailed_histogram_index];
-		int index = 0;
-		for ( int i=worker->helper.end_histogram_index; i < worker->histogram.array_len; i++ ){
-			if ( worker->histogram.array[i].item_index >= current_item.item_index ){
-				index = i;
-				break;
-			}
-		}
-		/*if current item of detailed_histogram is last item from detailed_histogram can be synchronized
-				e.g. equal to one of big histogram items then synchronize it;*/
-		if ( worker->histogram.array[index].item_index == current_item.item_index ){
-			worker->helper.begin_offset = worker->detailed_histogram.array[ worker->helper.begin_detailed_histogram_index ].item_index;
-			worker->helper.begin_histogram_index = worker->helper.end_histogram_index = index;
-			/*detailed histogram currently no needed, discard detailed histogram*/
-			free( worker->detailed_histogram.array );
-			worker->detailed_histogram.array = NULL;
-		}
-	}
-}
-
-
-void
-init_histogram( struct histogram_worker* worker ){
-	worker->helper.begin_offset = 0;
-	if ( worker->detailed_histogram.array ){
-		worker->helper.begin_histogram_index = -1; //uninitialized can't be used
-		worker->helper.begin_detailed_histogram_index = worker->helper.end_detailed_histogram_index;
-	}else{
-		worker->helper.begin_histogram_index = worker->helper.end_histogram_index;
-	}
-}
-
-void
-set_detailed_histogram( struct histogram_worker* worker, struct Histogram* detailed_histogram  ){
-	assert( !worker->detailed_histogram.array ); /*test: should not be previous detailed histograms*/
-	if ( detailed_histogram && detailed_histogram->array_len ){
-		int big_histogram_first_item_index = worker->histogram.array[worker->helper.end_histogram_index].item_index;
-		/*test: 0 item index of 'detailed histogram' should be equal to last item index of histogram*/
-		assert( detailed_histogram->array[0].item_index == big_histogram_first_item_index );
-		free(worker->detailed_histogram.array);
-		worker->detailed_histogram.array = NULL;
-		worker->detailed_histogram = *detailed_histogram;
-		/*pointing to begin of detailed histogram*/
-		worker->helper.begin_detailed_histogram_index = worker->helper.end_detailed_histogram_index=0;
-	}
-}
-
-void
-set_next_histogram( struct histogram_worker* worker ){
-	if ( worker->detailed_histogram.array ){
-		if ( worker->helper.end_detailed_histogram_index+1 == worker->detailed_histogram.array_len )
-			worker->current_histogram_complete = 1; //flag
-		if ( ! worker->current_histogram_complete )
-			worker->helper.end_detailed_histogram_index++;
-	}
-	else
-		worker->helper.end_histogram_index++;
-}
-
-
-HistogramArrayPtr
-value_at_cursor_histogram( struct histogram_worker* worker ){
-	struct Histogram *histogram = &worker->histogram;
-	int *end_histogram_index = &worker->helper.end_histogram_index;
-	if ( worker->detailed_histogram.array ){
-		histogram = &worker->detailed_histogram;
-		end_histogram_index = &worker->helper.end_detailed_histogram_index;
-	}
-
-	if ( !worker->current_histogram_complete && *end_histogram_index < histogram->array_len){
-		return &histogram->array[ *end_histogram_index ];
-	}
-	return 0;
-}
-
-
-int
-length_current_histogram( const struct histogram_worker* worker ){
-	const struct Histogram* histogram = &worker->histogram;
-	const int *end_histogram_index = &worker->helper.end_histogram_index;
-	if ( worker->detailed_histogram.array ){
-		histogram = &worker->detailed_histogram;
-		end_histogram_index = &worker->helper.end_detailed_histogram_index;
-	}
-	return histogram->array[ *end_histogram_index ].last_item_index - histogram->array[ *end_histogram_index ].item_index + 1;
-}
-
-void
-get_begin_end_histograms_item_indexes( const struct histogram_worker* worker, int *first_item_index, int *end_item_index ){
-	int begin_detail_index = worker->helper.begin_detailed_histogram_index;
-	int begin_index = worker->helper.begin_histogram_index;
-	if ( worker->detailed_histogram.array )	{
-		int min1 = worker->detailed_histogram.array[ begin_detail_index ].item_index;
-		if ( worker->helper.begin_offset > 0 ){
-			min1 = min( worker->helper.begin_offset, worker->detailed_histogram.array[ begin_detail_index ].item_index );
-		}
-		if ( begin_index != -1 ){
-			min1 = min( min1, worker->histogram.array[ begin_index ].item_index );
-		}
-		*first_item_index = min1;
-		*end_item_index = worker->detailed_histogram.array[worker->helper.end_detailed_histogram_index].item_index;
-		if ( worker->current_histogram_complete )
-			*end_item_index = *end_item_index+1;
-	}
-	else
-	{
-		if ( worker->helper.begin_offset > 0 ){
-			*first_item_index = min( worker->helper.begin_offset, worker->histogram.array[ begin_index ].item_index );
-		}
-		else
-			*first_item_index = worker->histogram.array[ begin_index ].item_index;
-		*end_item_index = worker->histogram.array[worker->helper.end_histogram_index].item_index;
-	}
-}
-
-int
-size_all_processed_histograms( const struct histogram_worker* array_workers, int array_len ){
-	int count = 0;
-	int begin_index = 0;
-	int end_index = 0;
-	for ( int i=0; i < array_len; i++ )	{
-		const struct histogram_worker* worker = &array_workers[i];
-		begin_index = 0;
-		end_index = 0;
-		get_begin_end_histograms_item_indexes( worker, &begin_index, &end_index );
-		count += end_index - begin_index;
-	}
-	return count;
-}
-
-
-void
-print_request_data_array( struct request_data_t* const range, int len ){
-	for ( int j=0; j < len; j++ )
-	{
-		printf("SEQUENCE N:%d, dst_pid=%d, src_pid=%d, findex %d, lindex %d \n",
-				j, (int)range[j].dst_pid, (int)range[j].src_pid, range[j].first_item_index, range[j].last_item_index );
-	}
-}
-
-
-void
-init_helper_array( struct histogram_helper_t *range, int len ){
-	for ( int j=0; j < len; j++ ){
-		range[j].begin_histogram_index=0;
-		range[j].end_histogram_index=0;
-		range[j].begin_offset = 0;
-	}
-}
-
-void
-init_request_data_array( struct request_data_t *req_data, int len ){
-	for ( int j=0; j < len; j++ ){
-		req_data[j].src_pid = 0;
-		req_data[j].dst_pid = 0;
-		req_data[j].first_item_index = 0;
-		req_data[j].last_item_index = 0;
-	}
-}
-
-void
-request_assign_detailed_histogram( void *context, int current_histogram_len,
-		struct histogram_worker* workers, int array_len, int last_request ){
-	pid_t pid = getpid();
-	struct request_data_t request_detailed_histogram[array_len];
-	for (int i=0; i < array_len; i++){
-		int start_index =
-				workers[i].histogram.array[workers[i].helper.end_histogram_index].item_index;
-
-		request_detailed_histogram[i].dst_pid = workers[i].histogram.src_pid;
-		request_detailed_histogram[i].src_pid = pid;
-		request_detailed_histogram[i].first_item_index = start_index;
-		request_detailed_histogram[i].last_item_index =
-				min(start_index + current_histogram_len * array_len, ARRAY_ITEMS_COUNT );
-#ifdef DEBUG
-		printf("\nWant %d range(%d, %d)\n",
-				request_detailed_histogram[i].dst_pid,
-				request_detailed_histogram[i].first_item_index,
-				request_detailed_histogram[i].last_item_index ); fflush(0);
-#endif
-	}
-
-	struct Histogram* detailed_histogram = channel_request_response_detailed_histograms_alloc_get_len(
-			context, request_detailed_histogram, array_len, last_request );
-	//save received detailed histograms into workers array
-	for ( int i=0; i < array_len; i++ ){
-		set_detailed_histogram( &workers[i], &detailed_histogram[i] );
-	}
-	/*free array memory, pointer data on cells is untouched
-	 *detailed_histogram items should be deleted after use*/
-	free(detailed_histogram); //free array cells, data on cells is un\touched
-
-}
-
-
-struct request_data_t**
-alloc_range_request_analize_histograms( void *context,
-		const struct Histogram *histograms_array, size_t len, struct node_pid_t *child, int child_len ){
-	pid_t pid = getpid();
-	struct request_data_t **result = NULL;
-	struct histogram_worker workers[len];
-	for ( int i=0; i < len; i++ ){
-		workers[i].histogram = histograms_array[i];
-		init_worker(&workers[i]);
-	}
-	int destination_index = 0;
-	int source_index_of_histogram = -1;
-	int allow_check_remove_detailed_hitogram = 0;
-	do{
-		int last_histograms_requested = 0;
-		int range_count = 0; /*items count processed for all destinations, max=ARRAY_ITEMS_COUNT*len*/
-		if ( destination_index > 0 ){
-			for (int j=0; j < len; j++){
-				init_histogram( &workers[j] );
-			}
-		}
-		while( range_count < ARRAY_ITEMS_COUNT ){
-			source_index_of_histogram = -1;
-			int is_valid_current_item = 0;
-
-			/*in case when histogram item of big histogram is equal to item of detailed histogram
-			then now switch from detailed to big histogram */
-			for (int i=0; i < len; i++){
-				/*Last requested detailed histograms should not be deleted to use it's data to completion of Analize*/
-				if ( !last_histograms_requested && allow_check_remove_detailed_hitogram )
-					check_remove_detailed_histogram( &workers[i] );
-			}
-
-			/*search histogram in array of histogram which terms to condition*/
-			/*cycle for histograms*/
-			HistogramArrayItem min_value; min_value.item = 0;
-			HistogramArrayPtr current_value;
-			for ( int i=0; i < len; i++ ){
-				current_value = value_at_cursor_histogram( &workers[i] );
-				if ( !current_value ) continue;
-				/*set first item as default minimum value*/
-				if ( -1 == source_index_of_histogram ){
-					min_value = *current_value;
-				}
-				//check both current begin & end are in minimum range
-				if ( current_value->item <= min_value.item )
-				{
-					min_value = *current_value;
-					source_index_of_histogram = i; /*save source index to use this histogram*/
-				}
-			}
-#ifdef DEBUG
-			assert( -1 != source_index_of_histogram );
-#endif
-			set_next_histogram( &workers[source_index_of_histogram] ); /*move cursor to next histogram*/
-			range_count = size_all_processed_histograms( workers, len );
-
-			//if up to end of ARRAY_ITEMS_COUNT range less than len histograms
-			//so request histograms with step=1
-			int histogram_len = length_current_histogram( &workers[source_index_of_histogram] );
-			if ( !workers[source_index_of_histogram].detailed_histogram.array &&
-				 range_count + len*histogram_len >= ARRAY_ITEMS_COUNT)
-			{
-				last_histograms_requested = destination_index+1 >= len;
-				printf("\r#%d Detailed Histograms recv start\n", destination_index );fflush(0);
-				request_assign_detailed_histogram( context, histogram_len, workers, len, last_histograms_requested );
-				printf("\r#%d Detailed Histograms received\n", destination_index );fflush(0);
-				allow_check_remove_detailed_hitogram = 0;
-			}
-		} //while
-		/*save range data based on histograms*/
-		if ( !result )
-			result = malloc( sizeof(struct request_data_t*)*len ); /*alloc memory for pointers*/
-		result[destination_index] = malloc( sizeof(struct request_data_t)*len ); /*alloc memory for one-dimension array*/
-		/*save results*/
-		for (int j=0; j < len; j++){
-			int first_item_index = 0;
-			int last_item_index = 0;
-			get_begin_end_histograms_item_indexes( &workers[j], &first_item_index, &last_item_index );
-			result[destination_index][j].first_item_index = first_item_index;
-			result[destination_index][j].last_item_index = last_item_index-1;
-			result[destination_index][j].src_pid = workers[j].histogram.src_pid;
-			for (int k=0; k < child_len; k++)
-				if ( histograms_array[j].src_pid == child[k].src_node_pid  )
-				{
-					result[destination_index][j].dst_pid = child[k].dst_node_pid;
-				}
-		}
-
-		allow_check_remove_detailed_hitogram = 1;
-		destination_index++;
-	}while( destination_index < len );
 
-	for ( int i=0; i < len; i++ ){
-		free(workers[i].detailed_histogram.array);
-	}
 
-	return result;
+double
+time_seconds(){
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
 }
 
 
@@ -438,6 +174,7 @@ receive_message_check( void *socket, void *message, size_t waiting_size ){
 				(int)pid, (int)msg_size, (int)waiting_size );
 		exit(0);
 	}
+	zmq_msg_close (&msg);
 	return msg_size;
 }
 
@@ -450,6 +187,7 @@ alloc_receive_message_get_size( void *socket, size_t *size ){
 	*size = zmq_msg_size (&msg);
 	message = malloc( *size );
 	memcpy (message, zmq_msg_data (&msg), *size);
+	zmq_msg_close (&msg);
 	return message;
 }
 
@@ -466,10 +204,56 @@ transmit_message( void *socket, const void *message, size_t size, int option ){
 	zmq_msg_close (&msg);
 }
 
+/**Wrap array into shared array, caller owns the first reference
+ * @return shared array, it's freed by shared_array_release of the last reference*/
+struct shared_array_t*
+alloc_shared_array( BigArrayPtr array ){
+	struct shared_array_t *shared = malloc( sizeof(struct shared_array_t) );
+	shared->array = array;
+	shared->refcount = 1;
+	pthread_mutex_init( &shared->lock, NULL );
+	return shared;
+}
+
+
+/*zmq_free_fn of zero-copy messages, hint is shared array*/
+void
+shared_array_release( void *data, void *hint ){
+	struct shared_array_t *shared = hint;
+	pthread_mutex_lock( &shared->lock );
+	int refcount = --shared->refcount;
+	pthread_mutex_unlock( &shared->lock );
+	if ( !refcount ){
+		pthread_mutex_destroy( &shared->lock );
+		free( shared->array );
+		free( shared );
+	}
+}
+
+
+/**Zero-copy send of part of shared array, zeromq holds reference of array until message is sent
+ * socket existing zmq write socket*/
 void
-channel_receive_sorted_ranges(  void *context, BigArrayPtr dst_array, int dst_array_len, int ranges_count ){
+transmit_shared_message( void *socket, struct shared_array_t *shared, const void *message, size_t size, int option ){
+	pthread_mutex_lock( &shared->lock );
+	++shared->refcount;
+	pthread_mutex_unlock( &shared->lock );
+	zmq_msg_t msg;
+	zmq_msg_init_data (&msg, (void*)message, size, shared_array_release, shared);
+	zmq_send (socket, &msg, option);
+	zmq_msg_close (&msg);
+}
+
+/**Every received range is sorted run, it's saved into returned array one after another,
+ * partition length isn't known in advance for sampling splitters mode
+ * @param array_len total length of received ranges
+ * @param runs_len, runs_src_pid if not NULL receive length & source pid of every run*/
+BigArrayPtr
+channel_receive_sorted_ranges_alloc_get_len( void *context, int ranges_count, int *array_len,
+		int *runs_len, pid_t *runs_src_pid ){
 	pid_t pid = getpid();
-	int recv_bytes_count = 0;
+	size_t recv_bytes_count = 0;
+	BigArrayPtr dst_array = NULL;
 
 	void *reader = zmq_socket(context, ZMQ_REP);
 	char transport[30];
@@ -483,10 +267,17 @@ channel_receive_sorted_ranges(  void *context, BigArrayPtr dst_array, int dst_ar
 #ifdef DEBUG
 		printf("%s recv array -->", transport);
 #endif
+		pid_t src_pid;
+		receive_message_check( reader, &src_pid, sizeof(src_pid) );
 		zmq_msg_t array_msg;
 		zmq_msg_init(&array_msg);
 		zmq_recv (reader, &array_msg, 0);
 		const size_t msg_size = zmq_msg_size(&array_msg);
+		if ( runs_len )
+			runs_len[i] = msg_size/sizeof(BigArrayItem);
+		if ( runs_src_pid )
+			runs_src_pid[i] = src_pid;
+		dst_array = realloc( dst_array, recv_bytes_count + msg_size );
 		memcpy( &dst_array[recv_bytes_count/sizeof(BigArrayItem)], zmq_msg_data (&array_msg), msg_size);
 		recv_bytes_count += msg_size;
 		zmq_msg_close (&array_msg);
@@ -500,16 +291,17 @@ channel_receive_sorted_ranges(  void *context, BigArrayPtr dst_array, int dst_ar
 #endif
 	}
 	zmq_close(reader);
-	assert( dst_array_len*sizeof(BigArrayItem) == recv_bytes_count );
+	*array_len = recv_bytes_count/sizeof(BigArrayItem);
 #ifdef DEBUG
 	printf("[%d] channel_receive_sorted_ranges OK\n", (int)pid );
 #endif
+	return dst_array;
 }
 
 
 void
 channel_send_sorted_ranges( void *context, const struct request_data_t* sequence, int sequence_len,
-		const BigArrayPtr src_array, int src_array_len ){
+		struct shared_array_t *src_array, int src_array_len ){
 	pid_t pid = getpid();
 
 	for ( int i=0; i < sequence_len; i++ )
@@ -522,12 +314,14 @@ channel_send_sorted_ranges( void *context, const struct request_data_t* sequence
 
 		const int array_len = sequence[i].last_item_index - sequence[i].first_item_index + 1;
 		const size_t array_size = array_len*sizeof(BigArrayItem);
-		const BigArrayPtr array = src_array+sequence[i].first_item_index;
+		const BigArrayPtr array = src_array->array+sequence[i].first_item_index;
 #ifdef DEBUG
-		printf("\n[%d]Sending array_size=%d; min=%d, max=%d via %s\n",
-				(int)pid, (int)array_size, array[0], array[array_len-1], transport);
+		printf("\n[%d]Sending array_size=%d; min=%llu, max=%llu via %s\n",
+				(int)pid, (int)array_size, (unsigned long long)item_key(array[0]),
+				(unsigned long long)item_key(array[array_len-1]), transport);
 #endif
-		transmit_message( writer, array, array_size, 0 );
+		transmit_message( writer, &pid, sizeof(pid), ZMQ_SNDMORE ); /*range is run of this source*/
+		transmit_shared_message( writer, src_array, array, array_size, 0 );
 #ifdef DEBUG
 	   	printf("\n[%d]Waiting receiver reply; via %s\n", (int)pid, transport);
 #endif
@@ -544,6 +338,236 @@ channel_send_sorted_ranges( void *context, const struct request_data_t* sequence
 }
 
 
+/*@return count of runs to poll, it's runs having space in queue*/
+static int
+stream_poll_items( struct stream_t *stream, void **sockets, zmq_pollitem_t *items, int *items_run ){
+	int count = 0;
+	for ( int i=0; i < stream->runs_count; i++ ){
+		if ( stream->runs[i].finished || stream->runs[i].count == STREAM_QUEUE_CHUNKS ) continue;
+		items[count].socket = sockets[i];
+		items[count].fd = 0;
+		items[count].events = ZMQ_POLLIN;
+		items[count].revents = 0;
+		items_run[count++] = i;
+	}
+	return count;
+}
+
+
+/*Receiver thread of streaming merge, it polls only runs having space in queue, so slow merging
+ *of run holds back its source*/
+static void*
+stream_receiver_thread( void *arg ){
+	struct stream_t *stream = arg;
+	const int runs_count = stream->runs_count;
+	void *sockets[runs_count];
+	for ( int i=0; i < runs_count; i++ ){
+		sockets[i] = zmq_socket( stream->context, ZMQ_PULL );
+		char transport[40];
+		sprintf( transport, "ipc://stream-%d-%d", (int)getpid(), (int)stream->src_pids[i] );
+		zmq_bind( sockets[i], transport );
+	}
+
+	int active_runs_count = runs_count;
+	while( active_runs_count ){
+		zmq_pollitem_t items[runs_count];
+		int items_run[runs_count];
+		pthread_mutex_lock( &stream->lock );
+		int items_count;
+		while( !(items_count = stream_poll_items( stream, sockets, items, items_run )) )
+			pthread_cond_wait( &stream->cond, &stream->lock );
+		pthread_mutex_unlock( &stream->lock );
+
+		zmq_poll( items, items_count, STREAM_POLL_TIMEOUT );
+		for ( int j=0; j < items_count; j++ ){
+			if ( !(items[j].revents & ZMQ_POLLIN) ) continue;
+			struct stream_run_t *run = &stream->runs[ items_run[j] ];
+			/*slot after queue tail is free & merging thread doesn't move tail, chunk is received into it*/
+			pthread_mutex_lock( &stream->lock );
+			zmq_msg_t *chunk = &run->chunks[ (run->first + run->count) % STREAM_QUEUE_CHUNKS ];
+			pthread_mutex_unlock( &stream->lock );
+			zmq_msg_init( chunk );
+			zmq_recv( sockets[items_run[j]], chunk, 0 );
+			pthread_mutex_lock( &stream->lock );
+			if ( !zmq_msg_size( chunk ) ){
+				/*empty message completes run*/
+				run->finished = 1;
+				--active_runs_count;
+				zmq_msg_close( chunk );
+			}
+			else
+				run->count++;
+			stream->last_chunk_time = time_seconds();
+			pthread_cond_broadcast( &stream->cond );
+			pthread_mutex_unlock( &stream->lock );
+		}
+	}
+	for ( int i=0; i < runs_count; i++ )
+		zmq_close( sockets[i] );
+	return NULL;
+}
+
+
+/**Wait until every run either has queued chunk or is finished.
+ * @param available output, count of queued chunks of every run, it's stable until merger
+ * releases it since receiver only appends chunks to queue
+ * @param finished output, run is finished and all its chunks are queued
+ * @return 1 if any chunk is available, 0 if all runs are complete*/
+static int
+stream_wait_window( struct stream_t *stream, int *available, int *finished ){
+	int any = 0;
+	pthread_mutex_lock( &stream->lock );
+	for ( int i=0; i < stream->runs_count; i++ ){
+		struct stream_run_t *run = &stream->runs[i];
+		while( !run->count && !run->finished )
+			pthread_cond_wait( &stream->cond, &stream->lock );
+		/*finished flag is read before count could be reduced by merger, so it's consistent*/
+		finished[i] = run->finished;
+		available[i] = run->count;
+		any |= available[i];
+	}
+	pthread_mutex_unlock( &stream->lock );
+	return any;
+}
+
+
+/**Close merged chunks of run and give its slots back to receiver*/
+static void
+stream_release_chunks( struct stream_t *stream, int run_index, int chunks_count ){
+	struct stream_run_t *run = &stream->runs[run_index];
+	if ( !chunks_count ) return;
+	for ( int k=0; k < chunks_count; k++ )
+		zmq_msg_close( &run->chunks[ (run->first + k) % STREAM_QUEUE_CHUNKS ] );
+	pthread_mutex_lock( &stream->lock );
+	run->first = (run->first + chunks_count) % STREAM_QUEUE_CHUNKS;
+	run->count -= chunks_count;
+	pthread_cond_broadcast( &stream->cond );
+	pthread_mutex_unlock( &stream->lock );
+}
+
+
+/**Receive ranges of all sources by chunks and merge it by windows as chunks arrive, receiving
+ * is going in parallel thread. Window bound is least last queued key of unfinished runs, so no
+ * item below it is still on the way; queued chunk pieces up to bound are merged in place by
+ * co-ranked parallel multiway merge.
+ * @param dst_array, dst_array_len merged array allocated by function, it's grown while merging
+ * because partition length isn't known in advance for sampling splitters mode
+ * @param src_pids run i is received from src_pids[i]
+ * @param windows_count output, count of merged windows
+ * @return time of last received chunk*/
+double
+channel_receive_merge_streamed_ranges( void *context, BigArrayPtr *dst_array, int *dst_array_len,
+		const pid_t *src_pids, int runs_count, int *windows_count ){
+	struct stream_t stream;
+	stream.context = context;
+	stream.runs_count = runs_count;
+	stream.src_pids = src_pids;
+	stream.runs = calloc( runs_count, sizeof(struct stream_run_t) );
+	stream.last_chunk_time = time_seconds();
+	pthread_mutex_init( &stream.lock, NULL );
+	pthread_cond_init( &stream.cond, NULL );
+	pthread_t receiver;
+	pthread_create( &receiver, NULL, stream_receiver_thread, &stream );
+
+	const int max_pieces = runs_count*STREAM_QUEUE_CHUNKS;
+	BigArrayPtr pieces[max_pieces];
+	int pieces_len[max_pieces];
+	int available[runs_count];
+	int finished[runs_count];
+	int head_offset[runs_count]; //merged items of head chunk of run
+	memset( head_offset, '\0', sizeof(head_offset) );
+	int merged_count = 0;
+	int capacity = ARRAY_ITEMS_COUNT;
+	BigArrayPtr merged_array = malloc( capacity*sizeof(BigArrayItem) );
+	*windows_count = 0;
+	while( stream_wait_window( &stream, available, finished ) ){
+		int bounded = 0;
+		SortKey bound = 0;
+		for ( int i=0; i < runs_count; i++ ){
+			if ( finished[i] ) continue;
+			zmq_msg_t *last = &stream.runs[i].chunks[ (stream.runs[i].first + available[i] - 1) % STREAM_QUEUE_CHUNKS ];
+			const BigArrayItem *data = zmq_msg_data( last );
+			SortKey key = item_key( data[ zmq_msg_size( last ) / sizeof(BigArrayItem) - 1 ] );
+			bound = bounded ? min( bound, key ) : key;
+			bounded = 1;
+		}
+
+		/*pieces of the same run go in run order, every piece is sorted run for multiway merge*/
+		int pieces_count = 0;
+		int window_len = 0;
+		int consumed[runs_count];
+		for ( int i=0; i < runs_count; i++ ){
+			consumed[i] = 0;
+			for ( int k=0; k < available[i]; k++ ){
+				zmq_msg_t *chunk = &stream.runs[i].chunks[ (stream.runs[i].first + k) % STREAM_QUEUE_CHUNKS ];
+				int offset = k ? 0 : head_offset[i];
+				BigArrayPtr data = (BigArrayPtr)zmq_msg_data( chunk ) + offset;
+				int len = zmq_msg_size( chunk ) / sizeof(BigArrayItem) - offset;
+				int cut = bounded ? array_upper_bound( data, len, bound ) : len;
+				if ( cut ){
+					pieces[pieces_count] = data;
+					pieces_len[pieces_count++] = cut;
+					window_len += cut;
+				}
+				if ( cut < len ){
+					/*rest of chunk is above bound, so are next chunks of run*/
+					head_offset[i] = offset + cut;
+					break;
+				}
+				head_offset[i] = 0;
+				consumed[i]++;
+			}
+		}
+
+		if ( merged_count + window_len > capacity ){
+			capacity = max( capacity + capacity/2, merged_count + window_len );
+			merged_array = realloc( merged_array, capacity*sizeof(BigArrayItem) );
+		}
+		if ( pieces_count )
+			parallel_multiway_merge( merged_array + merged_count, pieces, pieces_len, pieces_count, DST_MERGE_THREADS );
+		merged_count += window_len;
+		++*windows_count;
+		for ( int i=0; i < runs_count; i++ )
+			stream_release_chunks( &stream, i, consumed[i] );
+	}
+
+	pthread_join( receiver, NULL );
+	pthread_mutex_destroy( &stream.lock );
+	pthread_cond_destroy( &stream.cond );
+	free( stream.runs );
+	*dst_array = merged_array;
+	*dst_array_len = merged_count;
+	return stream.last_chunk_time;
+}
+
+
+/*Send every range by chunks and empty message after last chunk, high water mark of socket
+ *holds source back while destination queue is full*/
+void
+channel_stream_sorted_ranges( void *context, const struct request_data_t* sequence, int sequence_len,
+		struct shared_array_t *src_array, int src_array_len ){
+	pid_t pid = getpid();
+	for ( int i=0; i < sequence_len; i++ ){
+		void *writer = zmq_socket(context, ZMQ_PUSH);
+		uint64_t hwm = STREAM_QUEUE_CHUNKS;
+		zmq_setsockopt( writer, ZMQ_HWM, &hwm, sizeof(hwm) );
+		char transport[40];
+		sprintf( transport, "ipc://stream-%d-%d", (int)sequence[i].dst_pid, (int)pid );
+		zmq_connect(writer, transport);
+		for ( int first=sequence[i].first_item_index; first <= sequence[i].last_item_index; first+=STREAM_CHUNK_ITEMS ){
+			int len = min( STREAM_CHUNK_ITEMS, sequence[i].last_item_index - first + 1 );
+			transmit_shared_message( writer, src_array, src_array->array+first, len*sizeof(BigArrayItem), 0 );
+		}
+		/*end of run marker is empty message*/
+		zmq_msg_t msg;
+		zmq_msg_init (&msg);
+		zmq_send (writer, &msg, 0);
+		zmq_msg_close (&msg);
+		zmq_close(writer);
+	}
+}
+
+
 /**@param dst_pid destination process should receive ranges*/
 int
 channel_recv_sequences_request( void *context, struct request_data_t* sequence, pid_t *dst_pid ){
@@ -656,11 +680,12 @@ channel_recv_detailed_histograms_request(void *context, const BigArrayPtr source
 
 		HistogramArrayPtr histogram = alloc_histogram_array_get_len( source_array, offset, requested_length, 1, &histogram_len );
 
-		size_t sending_array_len = histogram_len;
+		size_t encoded_size;
+		uint8_t *encoded = alloc_histogram_encode_get_size( histogram, histogram_len, &encoded_size );
 		/*Response to request, entire reply contains requested detailed histogram*/
 		transmit_message( socket, &pid, sizeof(pid_t), ZMQ_SNDMORE );
-		transmit_message( socket, &sending_array_len, sizeof(size_t), ZMQ_SNDMORE );
-		transmit_message( socket, histogram, histogram_len*sizeof(HistogramArrayItem), 0 );
+		transmit_message( socket, encoded, encoded_size, 0 );
+		free( encoded );
 		free( histogram );
 #ifdef DEBUG
 		printf("\n[%d] histograms sent by %s\n", (int)pid, transport );fflush(0);
@@ -672,42 +697,79 @@ channel_recv_detailed_histograms_request(void *context, const BigArrayPtr source
 
 
 /*@param complete Flag 0 say to client in request that would be requested again, 1-last request send
+ *Requests are sent to all sources at once & replies are received by zmq_poll in order of arrival,
+ *so round costs latency of the slowest source
  *return Histogram Caller is responsive to free memory after using result*/
 struct Histogram*
 channel_request_response_detailed_histograms_alloc_get_len(void *context, const struct request_data_t* request_data,
 		int request_array_len, int complete ){
+	static int round = 0;
 	pid_t pid = getpid();
 	//alloc histograms array with items count should be requested/received
 	struct Histogram* detailed_histograms = malloc( sizeof(struct Histogram)*request_array_len );
 
+	double round_time = time_seconds();
+	void *sockets[request_array_len];
+	char received[request_array_len];
 	for( int i=0; i < request_array_len; i++ ){
-		void *socket = zmq_socket(context, ZMQ_REQ);
+		received[i] = 0;
+		sockets[i] = zmq_socket(context, ZMQ_REQ);
 		char transport[30];
 		sprintf( transport, "ipc://details-%d", request_data[i].dst_pid );
-		zmq_connect (socket, transport);
+		zmq_connect (sockets[i], transport);
 #ifdef DEBUG
 		printf("\n[%d] complete=%d, Sending detailed histogram requests by %s\n", (int)pid, complete, transport );fflush(0);
 #endif
 		//send detailed histogram request
-		transmit_message( socket, &request_data[i], sizeof(struct request_data_t), ZMQ_SNDMORE );
-		transmit_message( socket, &complete, sizeof(complete), 0 );
+		transmit_message( sockets[i], &request_data[i], sizeof(struct request_data_t), ZMQ_SNDMORE );
+		transmit_message( sockets[i], &complete, sizeof(complete), 0 );
+	}
 #ifdef DEBUG
-		printf("\n[%d] detailed histograms receiving\n", (int)pid );fflush(0);
+	printf("\n[%d] detailed histograms receiving\n", (int)pid );fflush(0);
 #endif
-		//recv reply
-		struct Histogram item;
-		receive_message_check( socket, &item.src_pid, sizeof(item.src_pid) );
-		receive_message_check( socket, &item.array_len, sizeof(item.array_len) );
-		size_t received_array_size;
-		item.array = alloc_receive_message_get_size( socket, &received_array_size );
-
+	double first_reply_time = 0;
+	int waiting = request_array_len;
+	while( waiting ){
+		zmq_pollitem_t items[request_array_len];
+		int items_source[request_array_len];
+		int items_count = 0;
+		for( int i=0; i < request_array_len; i++ ){
+			if ( received[i] ) continue;
+			items[items_count].socket = sockets[i];
+			items[items_count].fd = 0;
+			items[items_count].events = ZMQ_POLLIN;
+			items[items_count].revents = 0;
+			items_source[items_count++] = i;
+		}
+		zmq_poll( items, items_count, -1 );
+		for( int j=0; j < items_count; j++ ){
+			if ( !(items[j].revents & ZMQ_POLLIN) ) continue;
+			int i = items_source[j];
+			//recv reply
+			struct Histogram item;
+			receive_message_check( sockets[i], &item.src_pid, sizeof(item.src_pid) );
+			size_t received_array_size;
+			uint8_t *encoded = alloc_receive_message_get_size( sockets[i], &received_array_size );
+			int histogram_len;
+			item.array = alloc_histogram_decode_get_len( encoded, received_array_size, &histogram_len );
+			item.array_len = histogram_len;
+			free( encoded );
 #ifdef DEBUG
-		printf("\n[%d] detailed histograms received from%d: expected len:%d, received len:%d\n",
-				pid, item.src_pid, (int)(sizeof(HistogramArrayItem)*item.array_len), (int)received_array_size );fflush(0);
+			printf("\n[%d] detailed histograms received from%d: len:%d, received size:%d\n",
+					pid, item.src_pid, histogram_len, (int)received_array_size );fflush(0);
 #endif
-		detailed_histograms[i] = item;
-		zmq_close(socket);
+			detailed_histograms[i] = item;
+			received[i] = 1;
+			if ( waiting-- == request_array_len )
+				first_reply_time = time_seconds();
+		}
 	}
+	for( int i=0; i < request_array_len; i++ )
+		zmq_close(sockets[i]);
+	double now = time_seconds();
+	printf("Detailed histograms round %d: sources=%d, latency=%.4fs, first reply=%.4fs\n",
+			++round, request_array_len, now - round_time, first_reply_time - round_time );
+	fflush(0);
 	return detailed_histograms;
 }
 
@@ -723,9 +785,12 @@ channel_recv_histograms( void *context, struct Histogram *histograms, int wait_n
 		size_t array_size;
 
 		if ( EPACKET_HISTOGRAM == t.type ){
-			histograms[i].array = alloc_receive_message_get_size( reader, &array_size );
-			histograms[i].array_len = array_size / sizeof(HistogramArrayItem);
+			uint8_t *encoded = alloc_receive_message_get_size( reader, &array_size );
+			int histogram_len;
+			histograms[i].array = alloc_histogram_decode_get_len( encoded, array_size, &histogram_len );
+			histograms[i].array_len = histogram_len;
 			histograms[i].src_pid = t.src_pid;
+			free( encoded );
 		}
 		else if ( size ){
 			printf("channel_recv_histogram::wrong packet type %d size %d", t.type, (int)t.size);
@@ -741,14 +806,16 @@ channel_send_histogram( void *context, const struct Histogram *histogram ){
 	void *writer = zmq_socket(context, ZMQ_PUSH);
 	zmq_connect (writer, "ipc://histogram");
 
-	size_t array_size = sizeof(HistogramArrayItem)*(histogram->array_len);
+	size_t encoded_size;
+	uint8_t *encoded = alloc_histogram_encode_get_size( histogram->array, histogram->array_len, &encoded_size );
 	struct packet_data_t t;
 	t.type = EPACKET_HISTOGRAM;
 	t.src_pid = histogram->src_pid;
-	t.size = array_size;
+	t.size = encoded_size;
 
 	transmit_message(writer, &t, sizeof(t), ZMQ_SNDMORE);
-	transmit_message(writer, histogram->array, array_size, 0);
+	transmit_message(writer, encoded, encoded_size, 0);
+	free( encoded );
 
 	zmq_close(writer);
 }
@@ -812,19 +879,23 @@ channel_send_source_pids( void *context, const struct node_pid_t* pids, int pids
 
 void
 send_sort_result( void *context, BigArrayPtr sorted_array, int len ){
-	if ( !len ) return;
 	pid_t pid = getpid();
 	void *writer = zmq_socket(context, ZMQ_PUSH);
 	zmq_connect(writer, "ipc://sort-result");
 
-	uint32_t sorted_crc = array_crc( sorted_array, ARRAY_ITEMS_COUNT );
+	uint32_t sorted_crc = array_crc( sorted_array, len );
 
 	transmit_message( writer, &pid, sizeof(pid), ZMQ_SNDMORE );
-	transmit_message( writer, &sorted_array[0], sizeof(BigArrayItem), ZMQ_SNDMORE );
-	transmit_message( writer, &sorted_array[len-1], sizeof(BigArrayItem), ZMQ_SNDMORE );
+	transmit_message( writer, &len, sizeof(len), ZMQ_SNDMORE );
+	/*partition of sampling splitters mode can be empty, it's skipped by order test*/
+	SortKey min_key = len ? item_key( sorted_array[0] ) : 0;
+	SortKey max_key = len ? item_key( sorted_array[len-1] ) : 0;
+	transmit_message( writer, &min_key, sizeof(min_key), ZMQ_SNDMORE );
+	transmit_message( writer, &max_key, sizeof(max_key), ZMQ_SNDMORE );
 	transmit_message( writer, &sorted_crc, sizeof(sorted_crc), 0 );
 #ifdef DEBUG
-	printf( "[%d] send_sort_result: min=%d, max=%d, crc=%u\n", pid, sorted_array[0], sorted_array[len-1], sorted_crc );
+	printf( "[%d] send_sort_result: min=%llu, max=%llu, crc=%u\n",
+			pid, (unsigned long long)min_key, (unsigned long long)max_key, sorted_crc );
 #endif
 	zmq_close( writer );
 }
@@ -839,6 +910,7 @@ recv_sort_result( void *context, int waiting_results ){
 	struct sort_result *results = malloc( SRC_NODES_COUNT*sizeof(struct sort_result) );
 	for ( int i=0; i < waiting_results; i++ ){
 		receive_message_check( reader, &results[i].pid, sizeof(results[i].pid) );
+		receive_message_check( reader, &results[i].len, sizeof(results[i].len) );
 		receive_message_check( reader, &results[i].min, sizeof(results[i].min) );
 		receive_message_check( reader, &results[i].max, sizeof(results[i].max) );
 		receive_message_check( reader, &results[i].crc, sizeof(results[i].crc) );
@@ -848,80 +920,788 @@ recv_sort_result( void *context, int waiting_results ){
 }
 
 
+/*log engine used by local sort of node, to correlate it with phases timings*/
 void
-result_entry_point( int dst_nodes_count ){
-	pid_t pid = getpid();
-	void *context = zmq_init(1);
+print_sort_engine( const char *node_name, const struct sort_params_t *params, int array_len, double seconds ){
+	printf("[%d] %s sort engine=%s%s, items=%d, time=%.3fs\n",
+			(int)getpid(), node_name, sort_engine( params->used_engine )->name,
+			ESORT_AUTO == params->engine ? " (autotuned)" : "", array_len, seconds );
+	fflush(0);
+}
 
-	BigArrayPtr unsorted_array = NULL;
-	BigArrayPtr sorted_array = NULL;
 
-	/* Receiving process ids of source data supplier
-	 * list of source ids is not using currently and can be removed*/
-	int pids_len = 0;
-	pid_t* pids = channel_recv_source_pids_get_len( context, &pids_len );
-	/*---------------------------------------------*/
+/*Source: answer rank queries of manager by binary search until last query received, last answer
+ *also carries item equal to every pivot, zeroed item if source has no such item*/
+void
+channel_recv_rank_queries( void *context, const BigArrayPtr sorted_array, int array_len ){
+	void *socket = zmq_socket(context, ZMQ_REP);
+	char transport[30];
+	sprintf( transport, "ipc://rank-query-%d", (int)getpid() );
+	zmq_bind( socket, transport );
+	int is_complete = 0;
+	do{
+		receive_message_check( socket, &is_complete, sizeof(is_complete) );
+		size_t pivots_size;
+		SortKey *pivots = alloc_receive_message_get_size( socket, &pivots_size );
+		const int pivots_count = pivots_size / sizeof(SortKey);
+		struct rank_count_t *counts = malloc( sizeof(struct rank_count_t)*max( pivots_count, 1 ) );
+		BigArrayItem *items = is_complete ? malloc( sizeof(BigArrayItem)*max( pivots_count, 1 ) ) : NULL;
+		rank_query_counts( sorted_array, array_len, pivots, pivots_count, counts, items );
+		transmit_message( socket, counts, sizeof(struct rank_count_t)*pivots_count, is_complete ? ZMQ_SNDMORE : 0 );
+		if ( is_complete )
+			transmit_message( socket, items, sizeof(BigArrayItem)*pivots_count, 0 );
+		free( counts );
+		free( items );
+		free( pivots );
+	}while( !is_complete );
+	zmq_close( socket );
+}
 
-	unsorted_array = malloc( ARRAY_ITEMS_COUNT*sizeof(BigArrayItem) );
-	channel_receive_sorted_ranges( context, unsorted_array, ARRAY_ITEMS_COUNT, SRC_NODES_COUNT );
-	free(pids);
 
-	sorted_array = alloc_merge_sort( unsorted_array, ARRAY_ITEMS_COUNT );
+/*Requests are sent to all sources at once, sources answer in parallel*/
+void
+channel_request_rank_counts( void *context, const pid_t *src_pids, int sources_count, const SortKey *pivots,
+		int pivots_count, int complete, struct rank_count_t *counts, BigArrayItem *items ){
+	void *sockets[sources_count];
+	for ( int s=0; s < sources_count; s++ ){
+		sockets[s] = zmq_socket(context, ZMQ_REQ);
+		char transport[30];
+		sprintf( transport, "ipc://rank-query-%d", (int)src_pids[s] );
+		zmq_connect( sockets[s], transport );
+		transmit_message( sockets[s], &complete, sizeof(complete), ZMQ_SNDMORE );
+		transmit_message( sockets[s], pivots, sizeof(SortKey)*pivots_count, 0 );
+	}
+	for ( int s=0; s < sources_count; s++ ){
+		receive_message_check( sockets[s], counts + s*pivots_count, sizeof(struct rank_count_t)*pivots_count );
+		if ( complete ){
+			size_t size;
+			BigArrayItem *source_items = alloc_receive_message_get_size( sockets[s], &size );
+			if ( items && size == sizeof(BigArrayItem)*pivots_count )
+				memcpy( items + s*pivots_count, source_items, size );
+			free( source_items );
+		}
+		zmq_close( sockets[s] );
+	}
+}
 
-	//sort complete, test it
-	send_sort_result( context, sorted_array, ARRAY_ITEMS_COUNT );
 
-	free(unsorted_array);
-	zmq_term(context);
+/**Query mode: exact items of global quantiles by distributed bisection of rank queries, nearest rank method:
+ * key of quantile q is the least key having ceil(q*N) items not greater than it, N is items count of all sources.
+ * Last round queries found keys, so its counts confirm ranks of keys and sources answer it by items
+ * having found keys, item of quantile is taken from any source having it.
+ * @param items output
+ * @return 1 if ranks of all found keys are confirmed*/
+int
+query_quantiles( void *context, const struct Histogram *histograms, int len, const double *quantiles,
+		int quantiles_count, BigArrayItem *items ){
+	const long long items_count = (long long)ARRAY_ITEMS_COUNT*len;
+	pid_t src_pids[len];
+	for ( int s=0; s < len; s++ )
+		src_pids[s] = histograms[s].src_pid;
+
+	long long ranks[quantiles_count];
+	SortKey keys[quantiles_count];
+	SortKey low[quantiles_count], high[quantiles_count];
+	struct rank_count_t *counts = malloc( sizeof(struct rank_count_t)*len*quantiles_count );
+	BigArrayItem *sources_items = malloc( sizeof(BigArrayItem)*len*quantiles_count );
+	for ( int q=0; q < quantiles_count; q++ ){
+		ranks[q] = (long long)(quantiles[q]*items_count);
+		ranks[q] += ranks[q] < quantiles[q]*items_count; /*ceil*/
+		ranks[q] = min( max( ranks[q], 1LL ), items_count );
+	}
+	histograms_rank_brackets( histograms, len, ARRAY_ITEMS_COUNT, ranks, quantiles_count, low, high );
+	int rounds = 0;
+	int unresolved;
+	do{
+		unresolved = 0;
+		for ( int q=0; q < quantiles_count; q++ ){
+			keys[q] = low[q] + (high[q]-low[q])/2;
+			unresolved += low[q] < high[q];
+		}
+		channel_request_rank_counts( context, src_pids, len, keys, quantiles_count, !unresolved, counts,
+				sources_items );
+		++rounds;
+		for ( int q=0; q < quantiles_count; q++ ){
+			long long count_le = 0;
+			for ( int s=0; s < len; s++ )
+				count_le += counts[s*quantiles_count+q].less_equal;
+			if ( count_le >= ranks[q] )
+				high[q] = keys[q];
+			else
+				low[q] = keys[q]+1;
+		}
+	}while( unresolved );
+
+	int test_ok = 1;
+	for ( int q=0; q < quantiles_count; q++ ){
+		long long count_less = 0, count_le = 0;
+		int found = 0;
+		for ( int s=0; s < len; s++ ){
+			const struct rank_count_t *count = &counts[s*quantiles_count+q];
+			count_less += count->less;
+			count_le += count->less_equal;
+			if ( !found && count->less < count->less_equal ){
+				items[q] = sources_items[s*quantiles_count+q];
+				found = 1;
+			}
+		}
+		if ( !found || item_key( items[q] ) != keys[q] || !(count_less < ranks[q] && ranks[q] <= count_le) )
+			test_ok = 0;
+		char item_text[64];
+		printf("Quantile %g: rank=%lld, item=%s, items less=%lld, not greater=%lld\n",
+				quantiles[q], ranks[q], found ? item_format( items[q], item_text, sizeof(item_text) ) : "none",
+				count_less, count_le );
+	}
+	printf("Quantiles found: rounds=%d\n", rounds );
+	fflush(0);
+	free( counts );
+	free( sources_items );
+	return test_ok;
 }
 
+
+/*Query mode top-K: source sends its QUERY_TOP_K least items to manager*/
 void
-source_entry_point( int src_nodes_count ){
-	pid_t pid = getpid();
-	//create context and bind socket
-	void *context = zmq_init(SRC_NODES_COUNT);
+channel_send_top_k( void *context, const BigArrayPtr sorted_array, int array_len ){
+	void *writer = zmq_socket(context, ZMQ_PUSH);
+	zmq_connect(writer, "ipc://top-k");
+	struct packet_data_t t;
+	t.type = EPACKET_RANGE;
+	t.src_pid = getpid();
+	t.size = sizeof(BigArrayItem)*min( QUERY_TOP_K, array_len );
+	transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+	transmit_message( writer, sorted_array, t.size, 0 );
+	zmq_close(writer);
+}
 
-	BigArrayPtr unsorted_array = NULL;
-	BigArrayPtr partially_sorted_array = NULL;
 
-	//if first part of sorting in single thread are completed
-	if ( run_sort( &unsorted_array, &partially_sorted_array, ARRAY_ITEMS_COUNT ) ){
-		uint32_t crc = array_crc( partially_sorted_array, ARRAY_ITEMS_COUNT );
-		if ( ARRAY_ITEMS_COUNT ){
-			printf("Single process sorting complete min=%d, max=%d: TEST OK.\n",
-					partially_sorted_array[0], partially_sorted_array[ARRAY_ITEMS_COUNT-1] );
-			fflush(0);
+/**Query mode top-K: manager merges least items of sources
+ * @param top_len output, it's QUERY_TOP_K if sources have enough items
+ * @return least items of all sources, caller is responsive to free it*/
+BigArrayPtr
+channel_recv_top_k_alloc_get_len( void *context, int len, int *top_len ){
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	zmq_bind(reader, "ipc://top-k");
+	BigArrayPtr runs[len];
+	int runs_len[len];
+	int items_count = 0;
+	for ( int i=0; i < len; i++ ){
+		struct packet_data_t t;
+		t.type = EPACKET_UNKNOWN;
+		receive_message_check( reader, &t, sizeof(t) );
+		if ( EPACKET_RANGE != t.type ){
+			perror("channel_recv_top_k_alloc_get_len::packet Unknown");
+			exit(-1);
 		}
+		size_t size;
+		runs[i] = alloc_receive_message_get_size( reader, &size );
+		runs_len[i] = size / sizeof(BigArrayItem);
+		items_count += runs_len[i];
+	}
+	zmq_close(reader);
+	BigArrayPtr merged = malloc( sizeof(BigArrayItem)*max( items_count, 1 ) );
+	multiway_merge( merged, runs, runs_len, len );
+	for ( int i=0; i < len; i++ )
+		free( runs[i] );
+	*top_len = min( items_count, QUERY_TOP_K );
+	return merged;
+}
 
-		int histogram_len = 0;
-		HistogramArrayPtr histogram_array = alloc_histogram_array_get_len(
-				partially_sorted_array, 0, ARRAY_ITEMS_COUNT, 1000, &histogram_len );
 
-		struct Histogram single_histogram;
-		single_histogram.src_pid = pid;
-		single_histogram.array_len = histogram_len;
-		single_histogram.array = histogram_array;
-		//send histogram to manager
+/*Manager of query mode: sources are answering queries instead of exchange of sorted data*/
+void
+query_manager( void *context ){
+	double query_time = 0;
+	int test_ok;
+	if ( EQUERY_QUANTILES == QUERY_MODE ){
+		struct Histogram histograms[SRC_NODES_COUNT];
+		channel_recv_histograms( context, histograms, SRC_NODES_COUNT );
+		query_time = time_seconds();
+		const double quantiles[] = QUERY_QUANTILES;
+		const int quantiles_count = sizeof(quantiles)/sizeof(*quantiles);
+		BigArrayItem items[quantiles_count];
+		test_ok = query_quantiles( context, histograms, SRC_NODES_COUNT, quantiles, quantiles_count, items );
+		for ( int i=0; i < SRC_NODES_COUNT; i++ )
+			free( histograms[i].array );
+	}
+	else{
+		int top_len;
+		BigArrayPtr top = channel_recv_top_k_alloc_get_len( context, SRC_NODES_COUNT, &top_len );
+		/*sources are sending least items just after sorting, time is spent by merge only*/
+		query_time = time_seconds();
+		test_ok = top_len == min( QUERY_TOP_K, ARRAY_ITEMS_COUNT*SRC_NODES_COUNT );
+		for ( int i=0; i < top_len; i++ ){
+			if ( i && item_less( top[i], top[i-1] ) )
+				test_ok = 0;
+			char item_text[64];
+			printf("top[%d]=%s\n", i, item_format( top[i], item_text, sizeof(item_text) ) );
+		}
+		free( top );
+	}
+	printf( "Query complete, time=%.4fs, Test %d\n", time_seconds() - query_time, test_ok );
+	fflush(0);
+}
 
-		channel_send_histogram( context, &single_histogram );
-#ifdef DEBUG
-		printf( "Sent SRC[%d] Histogram:\n", single_histogram.src_pid );
-		print_histogram( single_histogram.array, single_histogram.array_len );
-		fflush(0);
-#endif
-		//recv histogram request until function return 0
-		channel_recv_detailed_histograms_request(context, partially_sorted_array, ARRAY_ITEMS_COUNT);
+
+/*send to every source the same splitters & destination pids in splitters order*/
+void
+channel_send_key_splitters( void *context, const struct key_splitter_t *splitters,
+		const struct node_pid_t *child, int len ){
+	pid_t dst_pids[len];
+	for ( int i=0; i < len; i++ )
+		dst_pids[i] = child[i].dst_node_pid;
+	for ( int i=0; i < len; i++ ){
+		void *writer = zmq_socket(context, ZMQ_PUSH);
+		char transport[30];
+		sprintf( transport, "ipc://range-request-%d", (int)child[i].src_node_pid );
+		zmq_connect(writer, transport);
+		struct packet_data_t t;
+		t.type = EPACKET_SPLITTERS;
+		t.src_pid = getpid();
+		t.size = len;
+		transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+		transmit_message( writer, dst_pids, sizeof(dst_pids), ZMQ_SNDMORE );
+		transmit_message( writer, splitters, sizeof(struct key_splitter_t)*(len-1), 0 );
+		zmq_close(writer);
+	}
+}
+
+
+/**Source of sampling splitters mode cuts own sorted array by received splitters
+ * @param sequence ranges of sorted array for every destination, len is destinations count*/
+void
+channel_recv_key_splitters_get_ranges( void *context, const BigArrayPtr sorted_array, int array_len,
+		struct request_data_t* sequence, int len ){
+	pid_t pid = getpid();
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	char transport[30];
+	sprintf( transport, "ipc://range-request-%d", (int)pid );
+	zmq_bind(reader, transport);
+	struct packet_data_t t;
+	t.type = EPACKET_UNKNOWN;
+	receive_message_check( reader, &t, sizeof(t) );
+	if ( t.type != EPACKET_SPLITTERS || t.size != len ){
+		perror("channel_recv_key_splitters_get_ranges::packet Unknown");
+		exit(-1);
+	}
+	pid_t dst_pids[len];
+	struct key_splitter_t splitters[len];
+	receive_message_check( reader, dst_pids, sizeof(dst_pids) );
+	receive_message_check( reader, splitters, sizeof(struct key_splitter_t)*(len-1) );
+	zmq_close(reader);
+
+	key_splitters_get_ranges( sorted_array, array_len, getpid(), splitters, dst_pids, sequence, len );
+}
+
+
+/*Decentralized splitters mode: manager sends pids table of all nodes to every source*/
+void
+channel_send_node_pids( void *context, const struct node_pid_t *child, int len ){
+	for ( int i=0; i < len; i++ ){
+		void *writer = zmq_socket(context, ZMQ_PUSH);
+		char transport[30];
+		sprintf( transport, "ipc://node-pids-%d", (int)child[i].src_node_pid );
+		zmq_connect(writer, transport);
+		struct packet_data_t t;
+		t.type = EPACKET_PID;
+		t.src_pid = getpid();
+		t.size = len;
+		transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+		transmit_message( writer, child, sizeof(struct node_pid_t)*len, 0 );
+		zmq_close(writer);
+	}
+}
+
+
+void
+channel_recv_node_pids( void *context, struct node_pid_t *child, int len ){
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	char transport[30];
+	sprintf( transport, "ipc://node-pids-%d", (int)getpid() );
+	zmq_bind(reader, transport);
+	struct packet_data_t t;
+	t.type = EPACKET_UNKNOWN;
+	receive_message_check( reader, &t, sizeof(t) );
+	if ( t.type != EPACKET_PID || t.size != len ){
+		perror("channel_recv_node_pids::packet Unknown");
+		exit(-1);
+	}
+	receive_message_check( reader, child, sizeof(struct node_pid_t)*len );
+	zmq_close(reader);
+}
+
+
+/**Decentralized splitters mode: all-gather of samples, source sends own compact samples to every
+ * other source and receives samples of all of them.
+ * @param histograms samples of sources in order of child table, array of own samples is copied*/
+void
+channel_allgather_samples( void *context, const struct Histogram *own_samples, const struct node_pid_t *child,
+		int len, struct Histogram *histograms ){
+	pid_t pid = getpid();
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	char transport[30];
+	sprintf( transport, "ipc://samples-%d", (int)pid );
+	zmq_bind(reader, transport);
+
+	size_t encoded_size;
+	uint8_t *encoded = alloc_histogram_encode_get_size( own_samples->array, own_samples->array_len, &encoded_size );
+	struct packet_data_t t;
+	t.type = EPACKET_HISTOGRAM;
+	t.src_pid = pid;
+	t.size = encoded_size;
+	for ( int i=0; i < len; i++ ){
+		if ( child[i].src_node_pid == pid ) continue;
+		void *writer = zmq_socket(context, ZMQ_PUSH);
+		sprintf( transport, "ipc://samples-%d", (int)child[i].src_node_pid );
+		zmq_connect(writer, transport);
+		transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+		transmit_message( writer, encoded, encoded_size, 0 );
+		zmq_close(writer);
+	}
+	free( encoded );
+
+	for ( int i=0; i < len; i++ ){
+		histograms[i].src_pid = child[i].src_node_pid;
+		if ( child[i].src_node_pid != pid ) continue;
+		histograms[i].array_len = own_samples->array_len;
+		histograms[i].array = malloc( sizeof(HistogramArrayItem)*own_samples->array_len );
+		memcpy( histograms[i].array, own_samples->array, sizeof(HistogramArrayItem)*own_samples->array_len );
+	}
+	for ( int received=1; received < len; received++ ){
+		receive_message_check( reader, &t, sizeof(t) );
+		if ( EPACKET_HISTOGRAM != t.type ){
+			perror("channel_allgather_samples::packet Unknown");
+			exit(-1);
+		}
+		encoded = alloc_receive_message_get_size( reader, &encoded_size );
+		int i = 0;
+		while( i < len && child[i].src_node_pid != t.src_pid )
+			i++;
+		if ( i == len ){
+			perror("channel_allgather_samples::source pid Unknown");
+			exit(-1);
+		}
+		int histogram_len;
+		histograms[i].array = alloc_histogram_decode_get_len( encoded, encoded_size, &histogram_len );
+		histograms[i].array_len = histogram_len;
+		free( encoded );
+	}
+	zmq_close(reader);
+}
+
+
+/*Source: answer radix count queries of manager until last one, counts of bucket are sent sparse
+ *if it has less than half of digits*/
+void
+channel_recv_radix_count_queries( void *context, const BigArrayPtr sorted_array, int array_len ){
+	void *socket = zmq_socket(context, ZMQ_REP);
+	char transport[30];
+	sprintf( transport, "ipc://radix-count-%d", (int)getpid() );
+	zmq_bind( socket, transport );
+	int *counts = malloc( sizeof(int)*RADIX_SPLITTER_BUCKETS );
+	struct radix_count_t *sparse_counts = malloc( sizeof(struct radix_count_t)*RADIX_SPLITTER_BUCKETS );
+	int is_complete = 0;
+	do{
+		receive_message_check( socket, &is_complete, sizeof(is_complete) );
+		size_t queries_size;
+		struct radix_query_t *queries = alloc_receive_message_get_size( socket, &queries_size );
+		const int queries_count = queries_size / sizeof(struct radix_query_t);
+		if ( !queries_count )
+			transmit_message( socket, NULL, 0, 0 );
+		for ( int q=0; q < queries_count; q++ ){
+			const int digits_count = radix_query_counts( sorted_array, array_len, &queries[q], sparse_counts );
+			const int option = q+1 < queries_count ? ZMQ_SNDMORE : 0;
+			int dense = RADIX_COUNTS_DENSE( digits_count );
+			transmit_message( socket, &dense, sizeof(dense), ZMQ_SNDMORE );
+			if ( dense ){
+				radix_counts_to_dense( sparse_counts, digits_count, counts );
+				transmit_message( socket, counts, sizeof(int)*RADIX_SPLITTER_BUCKETS, option );
+			}
+			else
+				transmit_message( socket, sparse_counts, sizeof(struct radix_count_t)*digits_count, option );
+		}
+		free( queries );
+	}while( !is_complete );
+	free( counts );
+	free( sparse_counts );
+	zmq_close( socket );
+}
+
+
+/**Manager: receive radix counts of query answered by source, dense counts are converted to sparse
+ * @param counts buffer of RADIX_SPLITTER_BUCKETS counts*/
+static void
+radix_counts_receive( void *socket, int *counts, struct radix_counts_t *answer ){
+	int dense;
+	receive_message_check( socket, &dense, sizeof(dense) );
+	if ( dense ){
+		receive_message_check( socket, counts, sizeof(int)*RADIX_SPLITTER_BUCKETS );
+		int digits_count = 0;
+		for ( int digit=0; digit < RADIX_SPLITTER_BUCKETS; digit++ )
+			digits_count += counts[digit] != 0;
+		answer->array = malloc( sizeof(struct radix_count_t)*max( digits_count, 1 ) );
+		answer->array_len = digits_count;
+		radix_counts_to_sparse( counts, digits_count, answer->array );
+		return;
+	}
+	size_t size;
+	answer->array = alloc_receive_message_get_size( socket, &size );
+	answer->array_len = size/sizeof(struct radix_count_t);
+}
+
+
+/*Queries are sent to all sources at once, sources answer in parallel*/
+struct radix_counts_t*
+channel_request_radix_counts_alloc( void *context, const pid_t *src_pids, int sources_count,
+		const struct radix_query_t *queries, int queries_count, int complete ){
+	void *sockets[sources_count];
+	for ( int s=0; s < sources_count; s++ ){
+		sockets[s] = zmq_socket(context, ZMQ_REQ);
+		char transport[30];
+		sprintf( transport, "ipc://radix-count-%d", (int)src_pids[s] );
+		zmq_connect( sockets[s], transport );
+		transmit_message( sockets[s], &complete, sizeof(complete), ZMQ_SNDMORE );
+		transmit_message( sockets[s], queries, sizeof(struct radix_query_t)*queries_count, 0 );
+	}
+	struct radix_counts_t *answers = NULL;
+	if ( queries_count ){
+		answers = malloc( sizeof(struct radix_counts_t)*queries_count*sources_count );
+		int *counts = malloc( sizeof(int)*RADIX_SPLITTER_BUCKETS );
+		for ( int s=0; s < sources_count; s++ )
+			for ( int q=0; q < queries_count; q++ )
+				radix_counts_receive( sockets[s], counts, &answers[q*sources_count+s] );
+		free( counts );
+	}
+	else
+		for ( int s=0; s < sources_count; s++ )
+			receive_message_check( sockets[s], NULL, 0 );
+	for ( int s=0; s < sources_count; s++ )
+		zmq_close( sockets[s] );
+	return answers;
+}
+
+
+#ifdef ARGSORT
+/*Manager: partition offset of destination is items count of all previous destinations*/
+void
+channel_send_partition_offsets( void *context, struct request_data_t** range, const struct node_pid_t *child, int len ){
+	GlobalRank offset = 0;
+	for ( int i=0; i < len; i++ ){
+		void *writer = zmq_socket(context, ZMQ_PUSH);
+		char transport[30];
+		sprintf( transport, "ipc://rank-offset-%d", (int)child[i].dst_node_pid );
+		zmq_connect(writer, transport);
+		struct packet_data_t t;
+		t.type = EPACKET_RANK_OFFSET;
+		t.src_pid = getpid();
+		t.size = sizeof(offset);
+		transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+		transmit_message( writer, &offset, sizeof(offset), 0 );
+		zmq_close(writer);
+		for ( int j=0; j < len; j++ )
+			offset += range[i][j].last_item_index - range[i][j].first_item_index + 1;
+	}
+}
+
+
+GlobalRank
+channel_recv_partition_offset( void *context ){
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	char transport[30];
+	sprintf( transport, "ipc://rank-offset-%d", (int)getpid() );
+	zmq_bind(reader, transport);
+	struct packet_data_t t;
+	t.type = EPACKET_UNKNOWN;
+	receive_message_check( reader, &t, sizeof(t) );
+	if ( t.type != EPACKET_RANK_OFFSET ){
+		perror("channel_recv_partition_offset::packet Unknown");
+		exit(-1);
+	}
+	GlobalRank offset;
+	receive_message_check( reader, &offset, sizeof(offset) );
+	zmq_close(reader);
+	return offset;
+}
+
+
+/**Merge sorted runs by loser tree, global rank of merged item is offset+merged index.
+ * @param runs_ranks caller provided, runs_ranks[r][i] gets global rank of i-th item of run r*/
+void
+merge_runs_get_ranks( BigArrayPtr dst_array, const BigArrayPtr *runs, const int *runs_len, int runs_count,
+		GlobalRank offset, GlobalRank **runs_ranks ){
+	struct loser_tree_t tree;
+	loser_tree_init( &tree, runs, runs_len, runs_count );
+	int winner;
+	while( (winner = loser_tree_winner( &tree )) != -1 ){
+		runs_ranks[winner][ tree.heads[winner] - runs[winner] ] = offset++;
+		*dst_array++ = *tree.heads[winner]++;
+		loser_tree_replay( &tree );
+	}
+	loser_tree_free( &tree );
+}
+
+
+/*Destination: ranks of every run are sent back to its source by single batch*/
+void
+channel_send_ranks( void *context, GlobalRank **runs_ranks, const int *runs_len, const pid_t *runs_src_pid,
+		int runs_count ){
+	for ( int i=0; i < runs_count; i++ ){
+		void *writer = zmq_socket(context, ZMQ_PUSH);
+		char transport[30];
+		sprintf( transport, "ipc://ranks-%d", (int)runs_src_pid[i] );
+		zmq_connect(writer, transport);
+		struct packet_data_t t;
+		t.type = EPACKET_RANKS;
+		t.src_pid = getpid();
+		t.size = runs_len[i]*sizeof(GlobalRank);
+		transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+		transmit_message( writer, runs_ranks[i], t.size, 0 );
+		zmq_close(writer);
+	}
+}
+
+
+/**Source: receive ranks batches of all destinations, batch is aligned to range sent to destination.
+ * @param ranks output, ranks[i] is global rank of i-th item of unsorted array*/
+void
+channel_recv_ranks( void *context, const struct request_data_t* sequence, int sequence_len,
+		const uint32_t *permutation, GlobalRank *ranks ){
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	char transport[30];
+	sprintf( transport, "ipc://ranks-%d", (int)getpid() );
+	zmq_bind(reader, transport);
+	for ( int i=0; i < sequence_len; i++ ){
+		struct packet_data_t t;
+		t.type = EPACKET_UNKNOWN;
+		receive_message_check( reader, &t, sizeof(t) );
+		int j = 0;
+		while( j < sequence_len && sequence[j].dst_pid != t.src_pid )
+			j++;
+		if ( j == sequence_len ){
+			perror("channel_recv_ranks::destination pid Unknown");
+			exit(-1);
+		}
+		const int first = sequence[j].first_item_index;
+		const int len = sequence[j].last_item_index - first + 1;
+		if ( t.type != EPACKET_RANKS || t.size != len*sizeof(GlobalRank) ){
+			perror("channel_recv_ranks::packet Unknown");
+			exit(-1);
+		}
+		size_t size;
+		GlobalRank *batch = alloc_receive_message_get_size( reader, &size );
+		for ( int k=0; k < len; k++ )
+			ranks[ permutation[first+k] ] = batch[k];
+		free( batch );
+	}
+	zmq_close(reader);
+}
+
+
+/*@return 1 if ranks of items increase in sorted order*/
+int
+test_ranks( const GlobalRank *ranks, const uint32_t *permutation, int len ){
+	for ( int i=1; i < len; i++ ){
+		if ( ranks[ permutation[i-1] ] >= ranks[ permutation[i] ] )
+			return 0;
+	}
+	return 1;
+}
+#endif //ARGSORT
+
+
+void
+result_entry_point( int dst_nodes_count ){
+	pid_t pid = getpid();
+	void *context = zmq_init(1);
+
+	BigArrayPtr unsorted_array = NULL;
+	BigArrayPtr sorted_array = NULL;
+
+	/* Receiving process ids of source data supplier,
+	 * streaming merge receives run of every source by own socket*/
+	int pids_len = 0;
+	pid_t* pids = channel_recv_source_pids_get_len( context, &pids_len );
+	/*---------------------------------------------*/
+	int sorted_array_len = 0;
+
+#if STREAM_CHUNK_ITEMS
+	double merge_time = time_seconds();
+	int windows_count = 0;
+	double transfer_time = channel_receive_merge_streamed_ranges( context, &sorted_array, &sorted_array_len,
+			pids, pids_len, &windows_count ) - merge_time;
+	printf("[%d] Dst streaming %d-way merge, threads=%d, items=%d, windows=%d, transfer=%.3fs, time=%.3fs\n",
+			(int)pid, pids_len, DST_MERGE_THREADS, sorted_array_len, windows_count, transfer_time,
+			time_seconds() - merge_time );
+	fflush(0);
+	free(pids);
+#else
+	int runs_len[SRC_NODES_COUNT];
+	pid_t runs_src_pid[SRC_NODES_COUNT];
+	unsorted_array = channel_receive_sorted_ranges_alloc_get_len( context, SRC_NODES_COUNT, &sorted_array_len,
+			runs_len, runs_src_pid );
+	sorted_array = malloc( sorted_array_len*sizeof(BigArrayItem) );
+	free(pids);
+
+	/*received ranges are sorted runs, so single k-way merge pass completes sorting*/
+	BigArrayPtr runs[SRC_NODES_COUNT];
+	for ( int i=0, first=0; i < SRC_NODES_COUNT; first+=runs_len[i++] )
+		runs[i] = unsorted_array + first;
+	double merge_time = time_seconds();
+#ifdef ARGSORT
+	GlobalRank offset = channel_recv_partition_offset( context );
+	GlobalRank *runs_ranks[SRC_NODES_COUNT];
+	GlobalRank *ranks = malloc( sorted_array_len*sizeof(GlobalRank) );
+	for ( int i=0, first=0; i < SRC_NODES_COUNT; first+=runs_len[i++] )
+		runs_ranks[i] = ranks + first;
+	merge_runs_get_ranks( sorted_array, runs, runs_len, SRC_NODES_COUNT, offset, runs_ranks );
+	printf("[%d] Dst argsort merge, ranks from %llu, time=%.3fs\n",
+			(int)pid, (unsigned long long)offset, time_seconds() - merge_time );
+	fflush(0);
+	channel_send_ranks( context, runs_ranks, runs_len, runs_src_pid, SRC_NODES_COUNT );
+	free( ranks );
+#else
+	parallel_multiway_merge( sorted_array, runs, runs_len, SRC_NODES_COUNT, DST_MERGE_THREADS );
+	printf("[%d] Dst %d-way merge, threads=%d, items=%d, time=%.3fs\n",
+			(int)pid, SRC_NODES_COUNT, DST_MERGE_THREADS, sorted_array_len, time_seconds() - merge_time );
+	fflush(0);
+#endif //ARGSORT
+#endif //STREAM_CHUNK_ITEMS
+
+	//sort complete, test it
+	send_sort_result( context, sorted_array, sorted_array_len );
+
+	free(unsorted_array);
+	free(sorted_array);
+	zmq_term(context);
+}
+
+void
+source_entry_point( int src_nodes_count ){
+	pid_t pid = getpid();
+	//create context and bind socket
+	void *context = zmq_init(SRC_NODES_COUNT);
+
+	BigArrayPtr unsorted_array = NULL;
+	BigArrayPtr partially_sorted_array = NULL;
+	struct sort_params_t sort_params;
+	sort_params.engine = SRC_SORT_ENGINE;
+	sort_params.threads_count = SRC_SORT_THREADS;
+	sort_params.runs_count = 0;
+
+	//if first part of sorting are completed
+	double sort_time = time_seconds();
+#ifdef ARGSORT
+	/*permutation of sorted items is kept to scatter received ranks*/
+	uint32_t *permutation = malloc( sizeof(uint32_t)*ARRAY_ITEMS_COUNT );
+	sort_params.engine = sort_params.used_engine = ESORT_RADIX;
+	int sorted = run_argsort( &unsorted_array, &partially_sorted_array, permutation, ARRAY_ITEMS_COUNT );
+#else
+	int sorted = run_sort( &sort_params, &unsorted_array, &partially_sorted_array, ARRAY_ITEMS_COUNT );
+#endif
+	if ( sorted ){
+		print_sort_engine( "Src", &sort_params, ARRAY_ITEMS_COUNT, time_seconds() - sort_time );
+		uint32_t crc = array_crc( partially_sorted_array, ARRAY_ITEMS_COUNT );
+		if ( ARRAY_ITEMS_COUNT ){
+			printf("Single process sorting complete min=%llu, max=%llu: TEST OK.\n",
+					(unsigned long long)item_key( partially_sorted_array[0] ),
+					(unsigned long long)item_key( partially_sorted_array[ARRAY_ITEMS_COUNT-1] ) );
+			if ( ESORT_ADAPTIVE == sort_params.used_engine )
+				printf("[%d] Adaptive sort runs count=%d, 1 means presorted data\n",
+						(int)pid, sort_params.runs_count );
+			fflush(0);
+		}
+
+		/*radix splitters mode has own counts instead of histograms,
+		 *sampling splitters modes send only DST_NODES_COUNT evenly spaced samples*/
+		int histogram_step = EQUERY_NONE == QUERY_MODE &&
+				(ESPLITTER_SAMPLING == SPLITTER_MODE || ESPLITTER_DECENTRALIZED == SPLITTER_MODE) ?
+				max( ARRAY_ITEMS_COUNT/DST_NODES_COUNT, 1 ) : HISTOGRAM_STEP;
+		int histogram_len = 0;
+		HistogramArrayPtr histogram_array = alloc_histogram_array_get_len(
+				partially_sorted_array, 0, ARRAY_ITEMS_COUNT, histogram_step, &histogram_len );
+
+		struct Histogram single_histogram;
+		single_histogram.src_pid = pid;
+		single_histogram.array_len = histogram_len;
+		single_histogram.array = histogram_array;
+		//send histogram to manager
+
+		/*quantiles query brackets ranks by coarse histograms regardless of splitters mode*/
+		if ( EQUERY_NONE != QUERY_MODE ? EQUERY_QUANTILES == QUERY_MODE :
+				ESPLITTER_RADIX != SPLITTER_MODE && ESPLITTER_DECENTRALIZED != SPLITTER_MODE )
+			channel_send_histogram( context, &single_histogram );
 #ifdef DEBUG
-		printf("\n!!!!!!!Hisograms Sending complete!!!!!!.\n");
+		printf( "Sent SRC[%d] Histogram:\n", single_histogram.src_pid );
+		print_histogram( single_histogram.array, single_histogram.array_len );
+		fflush(0);
 #endif
-		pid_t dst_pid = 0;
 		struct request_data_t req_data_array[SRC_NODES_COUNT];
 		init_request_data_array( req_data_array, SRC_NODES_COUNT);
-		channel_recv_sequences_request( context, req_data_array, &dst_pid );
-		channel_send_sorted_ranges( context, req_data_array, SRC_NODES_COUNT, partially_sorted_array, ARRAY_ITEMS_COUNT );
+		if ( EQUERY_QUANTILES == QUERY_MODE )
+			channel_recv_rank_queries( context, partially_sorted_array, ARRAY_ITEMS_COUNT );
+		else if ( EQUERY_TOP_K == QUERY_MODE )
+			channel_send_top_k( context, partially_sorted_array, ARRAY_ITEMS_COUNT );
+		else if ( ESPLITTER_DECENTRALIZED == SPLITTER_MODE ){
+			double splitters_time = time_seconds();
+			struct node_pid_t child[SRC_NODES_COUNT];
+			channel_recv_node_pids( context, child, SRC_NODES_COUNT );
+			struct Histogram histograms[SRC_NODES_COUNT];
+			channel_allgather_samples( context, &single_histogram, child, SRC_NODES_COUNT, histograms );
+			struct key_splitter_t splitters[DST_NODES_COUNT];
+			sampling_splitters( histograms, SRC_NODES_COUNT, splitters );
+			pid_t dst_pids[DST_NODES_COUNT];
+			for ( int i=0; i < DST_NODES_COUNT; i++ )
+				dst_pids[i] = child[i].dst_node_pid;
+			key_splitters_get_ranges( partially_sorted_array, ARRAY_ITEMS_COUNT, pid, splitters, dst_pids,
+					req_data_array, DST_NODES_COUNT );
+			for ( int i=0; i < SRC_NODES_COUNT; i++ )
+				free( histograms[i].array );
+			printf("[%d] Decentralized splitters search time=%.3fs\n", (int)pid, time_seconds() - splitters_time );
+			fflush(0);
+		}
+		else if ( ESPLITTER_SAMPLING == SPLITTER_MODE || ESPLITTER_EPSILON == SPLITTER_MODE ){
+			if ( ESPLITTER_EPSILON == SPLITTER_MODE )
+				channel_recv_rank_queries( context, partially_sorted_array, ARRAY_ITEMS_COUNT );
+			channel_recv_key_splitters_get_ranges( context, partially_sorted_array, ARRAY_ITEMS_COUNT,
+					req_data_array, SRC_NODES_COUNT );
+		}
+		else{
+			if ( ESPLITTER_BISECTION == SPLITTER_MODE )
+				channel_recv_rank_queries( context, partially_sorted_array, ARRAY_ITEMS_COUNT );
+			else if ( ESPLITTER_RADIX == SPLITTER_MODE )
+				channel_recv_radix_count_queries( context, partially_sorted_array, ARRAY_ITEMS_COUNT );
+			else
+				//recv histogram request until function return 0
+				channel_recv_detailed_histograms_request(context, partially_sorted_array, ARRAY_ITEMS_COUNT);
+#ifdef DEBUG
+			printf("\n!!!!!!!Hisograms Sending complete!!!!!!.\n");
+#endif
+			pid_t dst_pid = 0;
+			channel_recv_sequences_request( context, req_data_array, &dst_pid );
+		}
+		/*ranges are sent without copy, sorted array is freed when zeromq releases all of it*/
+		struct shared_array_t *shared_sorted_array = alloc_shared_array( partially_sorted_array );
+		if ( EQUERY_NONE == QUERY_MODE ){
+#if STREAM_CHUNK_ITEMS
+			channel_stream_sorted_ranges( context, req_data_array, SRC_NODES_COUNT, shared_sorted_array,
+					ARRAY_ITEMS_COUNT );
+#else
+			channel_send_sorted_ranges( context, req_data_array, SRC_NODES_COUNT, shared_sorted_array,
+					ARRAY_ITEMS_COUNT );
+#endif
+		}
+#ifdef ARGSORT
+		GlobalRank *ranks = malloc( sizeof(GlobalRank)*ARRAY_ITEMS_COUNT );
+		channel_recv_ranks( context, req_data_array, SRC_NODES_COUNT, permutation, ranks );
+		printf("[%d] Argsort ranks received: TEST %s.\n", (int)pid,
+				test_ranks( ranks, permutation, ARRAY_ITEMS_COUNT ) ? "OK" : "FAILED" );
+		fflush(0);
+		free( ranks );
+		free( permutation );
+#endif
 
 		free(unsorted_array);
-		free(partially_sorted_array);
+		shared_array_release( NULL, shared_sorted_array );
 	}
 	else{
 		printf("Single process sorting failed: TEST FAILED.\n");
@@ -931,6 +1711,316 @@ source_entry_point( int src_nodes_count ){
 	zmq_term(context);
 }
 
+#ifdef STRING_KEYS
+/*String keys mode. Sources send sorted samples instead of histograms, manager merges it and
+ *picks DST_NODES_COUNT-1 splitter strings, sources cut sorted arrays by splitters & send every
+ *range to destination as contiguous offsets, lcps & bytes blocks, destinations merge ranges.*/
+
+/*send strings [first, first+count) of array as header, offsets rebased to 0, lcps, bytes*/
+void
+channel_send_string_array( void *socket, const struct string_array_t *array, int first, int count, int option ){
+	const uint32_t first_offset = array->offsets[first];
+	struct string_block_header_t header;
+	header.count = count;
+	header.bytes_size = array->offsets[first+count] - first_offset;
+	uint32_t *offsets = malloc( sizeof(uint32_t)*(count+1) );
+	for ( int i=0; i <= count; i++ )
+		offsets[i] = array->offsets[first+i] - first_offset;
+
+	transmit_message( socket, &header, sizeof(header), ZMQ_SNDMORE );
+	transmit_message( socket, offsets, sizeof(uint32_t)*(count+1), ZMQ_SNDMORE );
+	transmit_message( socket, array->lcps+first, sizeof(uint32_t)*count, ZMQ_SNDMORE );
+	transmit_message( socket, array->bytes+first_offset, header.bytes_size, option );
+	free( offsets );
+}
+
+
+void
+channel_recv_string_array( void *socket, struct string_array_t *array ){
+	struct string_block_header_t header;
+	receive_message_check( socket, &header, sizeof(header) );
+	string_array_alloc( array, header.count, header.bytes_size );
+	receive_message_check( socket, array->offsets, sizeof(uint32_t)*(header.count+1) );
+	receive_message_check( socket, array->lcps, sizeof(uint32_t)*header.count );
+	receive_message_check( socket, array->bytes, header.bytes_size );
+	/*first string of block has no previous one*/
+	array->lcps[0] = 0;
+}
+
+
+void
+channel_send_string_samples( void *context, const struct string_array_t *samples ){
+	void *writer = zmq_socket(context, ZMQ_PUSH);
+	zmq_connect (writer, "ipc://histogram");
+	struct packet_data_t t;
+	t.type = EPACKET_HISTOGRAM;
+	t.src_pid = getpid();
+	t.size = samples->count;
+	transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+	channel_send_string_array( writer, samples, 0, samples->count, 0 );
+	zmq_close(writer);
+}
+
+
+void
+channel_recv_string_samples( void *context, struct string_array_t *samples, int wait_number ){
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	zmq_bind (reader, "ipc://histogram");
+	for( int i=0; i < wait_number; i++ ){
+		struct packet_data_t t; t.type = EPACKET_UNKNOWN;
+		receive_message_check( reader, &t, sizeof(t) );
+		if ( EPACKET_HISTOGRAM != t.type ){
+			printf("channel_recv_string_samples::wrong packet type %d", t.type);
+			exit(-1);
+		}
+		channel_recv_string_array( reader, &samples[i] );
+	}
+	zmq_close(reader);
+}
+
+
+/*send to every source the same splitters & destination pids in splitters order*/
+void
+channel_send_splitters( void *context, const struct string_array_t *splitters, const struct node_pid_t *child, int len ){
+	pid_t dst_pids[len];
+	for ( int i=0; i < len; i++ )
+		dst_pids[i] = child[i].dst_node_pid;
+	for ( int i=0; i < len; i++ ){
+		void *writer = zmq_socket(context, ZMQ_PUSH);
+		char transport[30];
+		sprintf( transport, "ipc://range-request-%d", (int)child[i].src_node_pid );
+		zmq_connect(writer, transport);
+		struct packet_data_t t;
+		t.type = EPACKET_SPLITTERS;
+		t.src_pid = getpid();
+		t.size = len;
+		transmit_message( writer, &t, sizeof(t), ZMQ_SNDMORE );
+		transmit_message( writer, dst_pids, sizeof(dst_pids), ZMQ_SNDMORE );
+		channel_send_string_array( writer, splitters, 0, splitters->count, 0 );
+		zmq_close(writer);
+	}
+}
+
+
+void
+channel_recv_splitters( void *context, struct string_array_t *splitters, pid_t *dst_pids, int len ){
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	char transport[30];
+	sprintf( transport, "ipc://range-request-%d", (int)getpid() );
+	zmq_bind(reader, transport);
+	struct packet_data_t t;
+	t.type = EPACKET_UNKNOWN;
+	receive_message_check( reader, &t, sizeof(t) );
+	if ( t.type != EPACKET_SPLITTERS || t.size != len ){
+		perror("channel_recv_splitters::packet Unknown");
+		exit(-1);
+	}
+	receive_message_check( reader, dst_pids, sizeof(pid_t)*len );
+	channel_recv_string_array( reader, splitters );
+	zmq_close(reader);
+}
+
+
+/*range i of sorted array is [cuts[i], cuts[i+1]), it's sent to dst_pids[i]*/
+void
+channel_send_string_ranges( void *context, const struct string_array_t *sorted_array,
+		const int *cuts, const pid_t *dst_pids, int len ){
+	for ( int i=0; i < len; i++ ){
+		void *writer = zmq_socket(context, ZMQ_REQ);
+		char transport[30];
+		sprintf( transport, "ipc://range%d", (int)dst_pids[i] );
+		zmq_connect(writer, transport);
+		channel_send_string_array( writer, sorted_array, cuts[i], cuts[i+1]-cuts[i], 0 );
+		char reply;
+		receive_message_check( writer, &reply, 1 );
+		zmq_close(writer);
+	}
+}
+
+
+void
+channel_receive_string_ranges( void *context, struct string_array_t *ranges, int ranges_count ){
+	void *reader = zmq_socket(context, ZMQ_REP);
+	char transport[30];
+	sprintf( transport, "ipc://range%d", (int)getpid() );
+	zmq_bind(reader, transport);
+	for ( int i=0; i < ranges_count; i++ ){
+		channel_recv_string_array( reader, &ranges[i] );
+		char reply='-';
+		transmit_message( reader, &reply, 1, 0 );
+	}
+	zmq_close(reader);
+}
+
+
+/*Destination result: first & last strings are sent to check order between destinations*/
+void
+send_string_sort_result( void *context, const struct string_array_t *sorted_array ){
+	pid_t pid = getpid();
+	void *writer = zmq_socket(context, ZMQ_PUSH);
+	zmq_connect(writer, "ipc://sort-result");
+	int is_sorted = test_string_sort_result( sorted_array );
+	uint32_t crc = string_array_crc( sorted_array );
+	int first = 0;
+	int count = min( sorted_array->count, 1 );
+	transmit_message( writer, &pid, sizeof(pid), ZMQ_SNDMORE );
+	transmit_message( writer, &sorted_array->count, sizeof(sorted_array->count), ZMQ_SNDMORE );
+	transmit_message( writer, &is_sorted, sizeof(is_sorted), ZMQ_SNDMORE );
+	transmit_message( writer, &crc, sizeof(crc), ZMQ_SNDMORE );
+	channel_send_string_array( writer, sorted_array, first, count, ZMQ_SNDMORE );
+	channel_send_string_array( writer, sorted_array, max( sorted_array->count-1, 0 ), count, 0 );
+	zmq_close( writer );
+}
+
+
+void
+string_result_entry_point( int dst_nodes_count ){
+	void *context = zmq_init(1);
+	int pids_len = 0;
+	pid_t* pids = channel_recv_source_pids_get_len( context, &pids_len );
+	free(pids);
+
+	struct string_array_t ranges[SRC_NODES_COUNT];
+	channel_receive_string_ranges( context, ranges, SRC_NODES_COUNT );
+	struct string_array_t sorted_array;
+	double merge_time = time_seconds();
+	string_multiway_merge( ranges, SRC_NODES_COUNT, &sorted_array );
+	printf("[%d] Dst string merge items=%d, time=%.3fs\n",
+			(int)getpid(), sorted_array.count, time_seconds() - merge_time );
+	fflush(0);
+	for ( int i=0; i < SRC_NODES_COUNT; i++ )
+		string_array_free( &ranges[i] );
+
+	send_string_sort_result( context, &sorted_array );
+	string_array_free( &sorted_array );
+	zmq_term(context);
+}
+
+
+void
+string_source_entry_point( int src_nodes_count ){
+	void *context = zmq_init(SRC_NODES_COUNT);
+	struct string_array_t unsorted_array;
+	struct string_array_t sorted_array;
+	alloc_string_array_fill_random( &unsorted_array, ARRAY_ITEMS_COUNT );
+	double sort_time = time_seconds();
+	string_sort( &unsorted_array, &sorted_array );
+	printf("[%d] Src string sort items=%d, bytes=%u, time=%.3fs\n",
+			(int)getpid(), sorted_array.count, sorted_array.offsets[sorted_array.count],
+			time_seconds() - sort_time );
+	fflush(0);
+	string_array_free( &unsorted_array );
+
+	struct string_array_t samples;
+	alloc_string_samples( &sorted_array, STRING_SAMPLE_STEP, &samples );
+	channel_send_string_samples( context, &samples );
+	string_array_free( &samples );
+
+	struct string_array_t splitters;
+	pid_t dst_pids[DST_NODES_COUNT];
+	channel_recv_splitters( context, &splitters, dst_pids, DST_NODES_COUNT );
+	int cuts[DST_NODES_COUNT+1];
+	cuts[0] = 0;
+	for ( int i=0; i < splitters.count; i++ ){
+		uint32_t len;
+		const char *splitter = string_at( &splitters, i, &len );
+		cuts[i+1] = string_upper_bound( &sorted_array, splitter, len );
+	}
+	cuts[DST_NODES_COUNT] = sorted_array.count;
+	channel_send_string_ranges( context, &sorted_array, cuts, dst_pids, DST_NODES_COUNT );
+
+	string_array_free( &splitters );
+	string_array_free( &sorted_array );
+	zmq_term(context);
+}
+
+
+/*Manager: merge samples of all sources and pick splitters at equal samples ranks*/
+void
+string_manager( void *context, const struct node_pid_t *child ){
+	struct string_array_t samples[SRC_NODES_COUNT];
+	channel_recv_string_samples( context, samples, SRC_NODES_COUNT );
+	struct string_array_t all_samples;
+	string_multiway_merge( samples, SRC_NODES_COUNT, &all_samples );
+
+	struct string_array_t splitters;
+	uint32_t bytes_size = 0;
+	int splitters_index[DST_NODES_COUNT-1];
+	for ( int i=0; i < DST_NODES_COUNT-1; i++ ){
+		splitters_index[i] = min( (i+1)*all_samples.count/DST_NODES_COUNT, max( all_samples.count-1, 0 ) );
+		bytes_size += all_samples.offsets[splitters_index[i]+1] - all_samples.offsets[splitters_index[i]];
+	}
+	string_array_alloc( &splitters, DST_NODES_COUNT-1, bytes_size );
+	bytes_size = 0;
+	for ( int i=0; i < DST_NODES_COUNT-1; i++ ){
+		uint32_t len;
+		const char *s = string_at( &all_samples, splitters_index[i], &len );
+		splitters.offsets[i] = bytes_size;
+		splitters.lcps[i] = 0;
+		memcpy( splitters.bytes+bytes_size, s, len );
+		bytes_size += len;
+	}
+	channel_send_splitters( context, &splitters, child, SRC_NODES_COUNT );
+
+	for ( int i=0; i < SRC_NODES_COUNT; i++ )
+		string_array_free( &samples[i] );
+	string_array_free( &all_samples );
+	string_array_free( &splitters );
+
+	/*results are in order of destinations as splitters*/
+	void *reader = zmq_socket(context, ZMQ_PULL);
+	zmq_bind(reader, "ipc://sort-result");
+	struct string_array_t first_strings[DST_NODES_COUNT];
+	struct string_array_t last_strings[DST_NODES_COUNT];
+	int counts[DST_NODES_COUNT];
+	int sort_ok = 1;
+	for ( int i=0; i < DST_NODES_COUNT; i++ ){
+		pid_t pid;
+		int count, is_sorted;
+		uint32_t crc;
+		receive_message_check( reader, &pid, sizeof(pid) );
+		receive_message_check( reader, &count, sizeof(count) );
+		receive_message_check( reader, &is_sorted, sizeof(is_sorted) );
+		receive_message_check( reader, &crc, sizeof(crc) );
+		int j = 0;
+		while( j < DST_NODES_COUNT && child[j].dst_node_pid != pid )
+			j++;
+		if ( j == DST_NODES_COUNT ){
+			perror("string_manager::destination pid Unknown");
+			exit(-1);
+		}
+		channel_recv_string_array( reader, &first_strings[j] );
+		channel_recv_string_array( reader, &last_strings[j] );
+		counts[j] = count;
+		if ( !is_sorted )
+			sort_ok = 0;
+		printf("results[%d], pid=%d, items=%d, sorted=%d, crc=%u\n", j, (int)pid, count, is_sorted, crc );
+		fflush(0);
+	}
+	zmq_close( reader );
+
+	/*last string of every not empty range should not be greater than first string of next one*/
+	int prev = -1;
+	for ( int i=0; i < DST_NODES_COUNT; i++ ){
+		if ( !counts[i] ) continue;
+		uint32_t a_len, b_len;
+		if ( prev != -1 ){
+			const char *a = string_at( &last_strings[prev], 0, &a_len );
+			const char *b = string_at( &first_strings[i], 0, &b_len );
+			if ( string_compare( a, a_len, b, b_len ) > 0 )
+				sort_ok = 0;
+		}
+		prev = i;
+	}
+	for ( int i=0; i < DST_NODES_COUNT; i++ ){
+		string_array_free( &first_strings[i] );
+		string_array_free( &last_strings[i] );
+	}
+	printf( "Distributed sort complete, Test %d\n", sort_ok );
+}
+#endif //STRING_KEYS
+
+#ifndef STRING_KEYS
 static int
 sortresult_comparator( const void *m1, const void *m2 )
 {
@@ -944,6 +2034,7 @@ sortresult_comparator( const void *m1, const void *m2 )
 	else return 0;
 	return 0;
 }
+#endif
 
 /** Parralel sorting of arrays in several processes.
  * Application run N processes, every process has own part of unsorted array.
@@ -954,6 +2045,20 @@ int
 main(int argc, char **argv){
 	pid_t pid = getpid();
 	struct node_pid_t child[SRC_NODES_COUNT];
+#ifdef ARGSORT
+	if ( ESPLITTER_SAMPLING == SPLITTER_MODE || ESPLITTER_EPSILON == SPLITTER_MODE ||
+			ESPLITTER_DECENTRALIZED == SPLITTER_MODE ){
+		/*ranks offsets of destinations are sent by manager, it knows it only for exact splitters*/
+		printf("Argsort mode needs exact splitters mode\n");
+		return -1;
+	}
+#endif
+#if defined(ARGSORT) || defined(STRING_KEYS)
+	if ( EQUERY_NONE != QUERY_MODE ){
+		printf("Query mode supports fixed size items sorting only\n");
+		return -1;
+	}
+#endif
 
 	for (int i = 0; i < SRC_NODES_COUNT; i++) {
 
@@ -961,7 +2066,11 @@ main(int argc, char **argv){
 
 		if ( child[i].src_node_pid == 0 ) {
 			/*it's child running, fork returned 0, it's CHILD act as Source node*/
+#ifdef STRING_KEYS
+			string_source_entry_point( SRC_NODES_COUNT );
+#else
 			source_entry_point( SRC_NODES_COUNT );
+#endif
 			exit(-1);
 		}
 		else if ((int) child[i].src_node_pid < 0) {
@@ -973,13 +2082,18 @@ main(int argc, char **argv){
 		}
 	}
 
-	for (int i = 0; i < DST_NODES_COUNT; i++) {
+	/*query mode doesn't exchange items, destinations aren't needed*/
+	for (int i = 0; EQUERY_NONE == QUERY_MODE && i < DST_NODES_COUNT; i++) {
 
 		child[i].dst_node_pid = fork();
 
 		if ( child[i].dst_node_pid == 0 ) {
 			/*it's child running, fork returned 0, this CHILD act as Destination node*/
+#ifdef STRING_KEYS
+			string_result_entry_point( DST_NODES_COUNT );
+#else
 			result_entry_point( DST_NODES_COUNT );
+#endif
 			exit(-1);
 		}
 		else if ((int) child[i].dst_node_pid < 0) {
@@ -997,46 +2111,106 @@ main(int argc, char **argv){
 
 	/*send to destination nodes the list of src pid's
 	 * It can be deleted because it's not used by destination nodes anymore*/
-	channel_send_source_pids( context, child, SRC_NODES_COUNT );
+	if ( EQUERY_NONE == QUERY_MODE )
+		channel_send_source_pids( context, child, SRC_NODES_COUNT );
 	/*--------------------------------------------*/
 
+#ifdef STRING_KEYS
+	string_manager( context, child );
+#else
+	if ( EQUERY_NONE != QUERY_MODE ){
+		query_manager( context );
+		zmq_term (context);
+		while (wait(NULL) > 0)	/* now parent waits for all children */
+			;
+		return 0;
+	}
 	struct Histogram histograms[SRC_NODES_COUNT];
 	int histogram_array_len = -1;
 
-	channel_recv_histograms( context, histograms, SRC_NODES_COUNT );
-	struct request_data_t** range = alloc_range_request_analize_histograms( context, histograms, SRC_NODES_COUNT,
-			child, SRC_NODES_COUNT );
+	for ( int i=0; i < SRC_NODES_COUNT; i++ )
+		histograms[i].array = NULL;
+	if ( ESPLITTER_RADIX != SPLITTER_MODE && ESPLITTER_DECENTRALIZED != SPLITTER_MODE )
+		channel_recv_histograms( context, histograms, SRC_NODES_COUNT );
+	double splitters_time = time_seconds();
+	if ( ESPLITTER_DECENTRALIZED == SPLITTER_MODE )
+		/*sources find splitters themselves, manager only gives them pids of all nodes*/
+		channel_send_node_pids( context, child, SRC_NODES_COUNT );
+	else if ( ESPLITTER_SAMPLING == SPLITTER_MODE || ESPLITTER_EPSILON == SPLITTER_MODE ){
+		struct key_splitter_t splitters[DST_NODES_COUNT];
+		if ( ESPLITTER_SAMPLING == SPLITTER_MODE )
+			sampling_splitters( histograms, SRC_NODES_COUNT, splitters );
+		else
+			epsilon_key_splitters( context, ARRAY_ITEMS_COUNT, histograms, SRC_NODES_COUNT, splitters );
+		channel_send_key_splitters( context, splitters, child, SRC_NODES_COUNT );
+		printf("Splitters search time=%.3fs\n", time_seconds() - splitters_time );
+		fflush(0);
+	}
+	else{
+		struct request_data_t** range;
+		if ( ESPLITTER_BISECTION == SPLITTER_MODE )
+			range = alloc_range_request_bisect_ranks( context, ARRAY_ITEMS_COUNT, histograms, SRC_NODES_COUNT,
+					child, SRC_NODES_COUNT );
+		else if ( ESPLITTER_RADIX == SPLITTER_MODE )
+			range = alloc_range_request_radix_counts( context, ARRAY_ITEMS_COUNT, child, SRC_NODES_COUNT );
+		else{
+			range = alloc_range_request_analize_histograms( context, ARRAY_ITEMS_COUNT, histograms, SRC_NODES_COUNT,
+					child, SRC_NODES_COUNT );
+			if ( !range ){
+				perror("alloc_range_request_analize_histograms::histograms walk failed");
+				exit(-1);
+			}
+		}
+		printf("Splitters search time=%.3fs\n", time_seconds() - splitters_time );
+		fflush(0);
 
 #ifdef DEBUG
-	for (int i=0; i < SRC_NODES_COUNT; i++ )
-	{
-		printf( "SOURCE PART N %d:\n", i );
-		print_request_data_array( range[i], SRC_NODES_COUNT );
-	}
+		for (int i=0; i < SRC_NODES_COUNT; i++ )
+		{
+			printf( "SOURCE PART N %d:\n", i );
+			print_request_data_array( range[i], SRC_NODES_COUNT );
+		}
 #endif
 
-	channel_send_sequences_request( context, range, child, SRC_NODES_COUNT );
+		channel_send_sequences_request( context, range, child, SRC_NODES_COUNT );
+#ifdef ARGSORT
+		channel_send_partition_offsets( context, range, child, SRC_NODES_COUNT );
+#endif
+		for ( int i=0; i < SRC_NODES_COUNT; i++ )
+			free( range[i] );
+		free(range);
+	}
 
-	for ( int i=0; i < SRC_NODES_COUNT; i++ ){
+	for ( int i=0; i < SRC_NODES_COUNT; i++ )
 		free(histograms[i].array);
-		free( range[i] );
-	}
-	free(range);
 
 	struct sort_result *results = recv_sort_result( context, SRC_NODES_COUNT );
 	qsort( results, SRC_NODES_COUNT, sizeof(struct sort_result), sortresult_comparator );
 	int sort_ok = 1;
-	for ( int i=0; i < SRC_NODES_COUNT; i++ ){
-		if ( i>0 ){
-			if ( !(results[i].max > results[i].min && results[i-1].max < results[i].min) )
+	long long items_count = 0;
+	int max_len = 0;
+	for ( int i=0, prev=-1; i < SRC_NODES_COUNT; i++ ){
+		items_count += results[i].len;
+		max_len = max( max_len, results[i].len );
+		/*empty partitions are possible in sampling splitters mode, duplicates run can be split
+		 *between destinations, so neighbour partitions can share boundary key*/
+		if ( results[i].len ){
+			if ( prev != -1 && !(results[i].max >= results[i].min && results[prev].max <= results[i].min) )
 				sort_ok = 0;
+			prev = i;
 		}
-		printf("results[%d], pid=%d, min=%d, max=%d\n",
-				i, results[i].pid, results[i].min, results[i].max);
+		printf("results[%d], pid=%d, items=%d, min=%llu, max=%llu\n",
+				i, results[i].pid, results[i].len,
+				(unsigned long long)results[i].min, (unsigned long long)results[i].max);
 		fflush(0);
 	}
+	if ( items_count != (long long)ARRAY_ITEMS_COUNT*SRC_NODES_COUNT )
+		sort_ok = 0;
+	/*1.0 is ideal balance of destinations*/
+	printf( "Partitions balance max/avg=%.4f\n", (double)max_len*DST_NODES_COUNT/max( items_count, 1LL ) );
 
 	printf( "Distributed sort complete, Test %d\n", sort_ok );
+#endif //STRING_KEYS
 
 	zmq_term (context);
 
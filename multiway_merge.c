@@ -0,0 +1,255 @@
+/*
+ * multiway_merge.c
+ *
+ *      K-way merge of sorted runs by tournament tree of losers & cache-blocked local sort:
+ *      array is sorted by blocks fitting into L2 cache, then blocks are merged by one or
+ *      two multiway merge passes instead of log2(n) binary merge passes over memory.
+ */
+
+#include "sort.h"
+#include <stdlib.h>
+#include <unistd.h> //sysconf()
+
+/*Used if L2 cache size is not reported by system*/
+#define DEFAULT_L2_CACHE_SIZE (256*1024)
+/*Max runs count merged by single multiway merge*/
+#define MULTIWAY_MAX_RUNS 256
+
+
+/*exhausted run is greater than any other, equal items are ordered by run index*/
+static inline int
+loser_tree_less( const struct loser_tree_t *tree, int run_a, int run_b ){
+	if ( tree->heads[run_a] == tree->ends[run_a] ) return 0;
+	if ( tree->heads[run_b] == tree->ends[run_b] ) return 1;
+	const SortKey a = item_key( *tree->heads[run_a] );
+	const SortKey b = item_key( *tree->heads[run_b] );
+	return a < b || (a == b && run_a < run_b);
+}
+
+
+/**@param runs array of sorted runs, runs_len[i] is length of runs[i]*/
+void
+loser_tree_init( struct loser_tree_t *tree, const BigArrayPtr *runs, const int *runs_len, int runs_count ){
+	int leaves_count = 1;
+	while( leaves_count < runs_count )
+		leaves_count *= 2;
+	tree->runs_count = runs_count;
+	tree->leaves_count = leaves_count;
+	tree->heads = malloc( sizeof(BigArrayItem*)*leaves_count );
+	tree->ends = malloc( sizeof(BigArrayItem*)*leaves_count );
+	tree->losers = malloc( sizeof(int)*leaves_count );
+	for ( int i=0; i < leaves_count; i++ ){
+		/*leaves over runs_count are empty runs*/
+		tree->heads[i] = i < runs_count ? runs[i] : NULL;
+		tree->ends[i] = i < runs_count ? runs[i]+runs_len[i] : NULL;
+	}
+
+	/*play tournament bottom-up, inner node n has children 2n & 2n+1, leaf of run i is leaves_count+i*/
+	int winners[2*leaves_count];
+	for ( int i=0; i < leaves_count; i++ )
+		winners[leaves_count+i] = i;
+	for ( int node=leaves_count-1; node >= 1; node-- ){
+		int left = winners[2*node];
+		int right = winners[2*node+1];
+		if ( loser_tree_less( tree, right, left ) ){
+			winners[node] = right;
+			tree->losers[node] = left;
+		}
+		else{
+			winners[node] = left;
+			tree->losers[node] = right;
+		}
+	}
+	tree->losers[0] = winners[1];
+}
+
+
+/**Replay matches from leaf of winner run to root, it should be called after head of winner
+ * run is moved*/
+void
+loser_tree_replay( struct loser_tree_t *tree ){
+	int winner = tree->losers[0];
+	for ( int node=(tree->leaves_count+winner)/2; node >= 1; node/=2 ){
+		if ( loser_tree_less( tree, tree->losers[node], winner ) ){
+			int swap = tree->losers[node];
+			tree->losers[node] = winner;
+			winner = swap;
+		}
+	}
+	tree->losers[0] = winner;
+}
+
+
+/**@return run index holding least head item or -1 if all runs are exhausted*/
+int
+loser_tree_winner( const struct loser_tree_t *tree ){
+	int winner = tree->losers[0];
+	return tree->heads[winner] == tree->ends[winner] ? -1 : winner;
+}
+
+
+void
+loser_tree_free( struct loser_tree_t *tree ){
+	free( tree->heads );
+	free( tree->ends );
+	free( tree->losers );
+}
+
+
+/*@return index of first item of sorted run with key not less than key*/
+int
+array_lower_bound( const BigArrayItem *run, int run_len, SortKey key ){
+	int first = 0;
+	while( run_len > 0 ){
+		int half = run_len/2;
+		if ( item_key( run[first+half] ) < key ){
+			first += half+1;
+			run_len -= half+1;
+		}
+		else
+			run_len = half;
+	}
+	return first;
+}
+
+/*@return index of first item of sorted run with key greater than key*/
+int
+array_upper_bound( const BigArrayItem *run, int run_len, SortKey key ){
+	int first = 0;
+	while( run_len > 0 ){
+		int half = run_len/2;
+		if ( item_key( run[first+half] ) <= key ){
+			first += half+1;
+			run_len -= half+1;
+		}
+		else
+			run_len = half;
+	}
+	return first;
+}
+
+
+/**Co-ranking: find split of sorted runs for output rank, merged items before rank are
+ * runs[i][0..splits[i]). It's binary search of least key having rank items not greater than it,
+ * items less than key are taken from all runs, equal items are taken by runs order as by
+ * loser tree, so pieces merged independently give the same result as multiway_merge.
+ * @param splits output, runs_count items*/
+void
+multiway_merge_split( const BigArrayPtr *runs, const int *runs_len, int runs_count, int rank, int *splits ){
+	SortKey low = 0, high = 0;
+	int empty = 1;
+	for ( int i=0; i < runs_count; i++ ){
+		splits[i] = 0;
+		if ( !runs_len[i] ) continue;
+		SortKey first = item_key( runs[i][0] );
+		SortKey last = item_key( runs[i][runs_len[i]-1] );
+		if ( empty || first < low ) low = first;
+		if ( empty || last > high ) high = last;
+		empty = 0;
+	}
+	if ( empty || rank <= 0 ) return;
+
+	while( low < high ){
+		SortKey middle = low + (high-low)/2;
+		int count = 0;
+		for ( int i=0; i < runs_count; i++ )
+			count += array_upper_bound( runs[i], runs_len[i], middle );
+		if ( count >= rank )
+			high = middle;
+		else
+			low = middle+1;
+	}
+
+	int need = rank;
+	for ( int i=0; i < runs_count; i++ ){
+		splits[i] = array_lower_bound( runs[i], runs_len[i], low );
+		need -= splits[i];
+	}
+	for ( int i=0; i < runs_count && need > 0; i++ ){
+		int equal_count = array_upper_bound( runs[i], runs_len[i], low ) - splits[i];
+		int taken = min_len( need, equal_count );
+		splits[i] += taken;
+		need -= taken;
+	}
+}
+
+
+/**Merge sorted runs into dst_array, it should not overlap with runs*/
+void
+multiway_merge( BigArrayPtr dst_array, const BigArrayPtr *runs, const int *runs_len, int runs_count ){
+	if ( runs_count == 1 ){
+		copy_array( dst_array, runs[0], runs_len[0] );
+		return;
+	}
+	if ( runs_count == 2 ){
+		merge_into( dst_array, runs[0], runs_len[0], runs[1], runs_len[1] );
+		return;
+	}
+	struct loser_tree_t tree;
+	loser_tree_init( &tree, runs, runs_len, runs_count );
+	int winner;
+	while( (winner = loser_tree_winner( &tree )) != -1 ){
+		*dst_array++ = *tree.heads[winner]++;
+		loser_tree_replay( &tree );
+	}
+	loser_tree_free( &tree );
+}
+
+
+/**Cache-aware local sort. Blocks of half of L2 cache size are sorted in cache with the same
+ * size of scratch, then sorted blocks are merged by multiway merge passes of up to
+ * MULTIWAY_MAX_RUNS runs, ping-ponged so that last pass writes into sorted_array.
+ * @param sorted_array caller provided output, array_len items*/
+void
+cache_blocked_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len ){
+	long cache_size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+	if ( cache_size <= 0 )
+		cache_size = DEFAULT_L2_CACHE_SIZE;
+	const int block_len = cache_size / (2*sizeof(BigArrayItem));
+	if ( array_len <= block_len ){
+		bottom_up_merge_sort( array, sorted_array, array_len );
+		return;
+	}
+
+	int blocks_count = (array_len + block_len - 1) / block_len;
+	int passes = 0;
+	for ( int runs=blocks_count; runs > 1; runs=(runs+MULTIWAY_MAX_RUNS-1)/MULTIWAY_MAX_RUNS )
+		++passes;
+	BigArrayPtr scratch = malloc( sizeof(BigArrayItem)*array_len );
+	BigArrayPtr src = passes%2 ? scratch : sorted_array;
+	BigArrayPtr dst = passes%2 ? sorted_array : scratch;
+
+	/*block scratch is reused by all blocks to keep it in cache*/
+	BigArrayPtr block_scratch = malloc( sizeof(BigArrayItem)*block_len );
+	int *runs_first = malloc( sizeof(int)*(blocks_count+1) );
+	for ( int i=0; i < blocks_count; i++ ){
+		runs_first[i] = i*block_len;
+		int len = min_len( block_len, array_len - runs_first[i] );
+		bottom_up_merge_sort_scratch( array+runs_first[i], src+runs_first[i], len, block_scratch );
+	}
+	runs_first[blocks_count] = array_len;
+	free( block_scratch );
+
+	BigArrayPtr runs[MULTIWAY_MAX_RUNS];
+	int runs_len[MULTIWAY_MAX_RUNS];
+	int runs_count = blocks_count;
+	while( runs_count > 1 ){
+		int next_runs_count = 0;
+		for ( int r=0; r < runs_count; r+=MULTIWAY_MAX_RUNS ){
+			int group_len = min_len( MULTIWAY_MAX_RUNS, runs_count-r );
+			for ( int j=0; j < group_len; j++ ){
+				runs[j] = src + runs_first[r+j];
+				runs_len[j] = runs_first[r+j+1] - runs_first[r+j];
+			}
+			multiway_merge( dst+runs_first[r], runs, runs_len, group_len );
+			runs_first[next_runs_count++] = runs_first[r];
+		}
+		runs_first[next_runs_count] = array_len;
+		runs_count = next_runs_count;
+		BigArrayPtr swap = src;
+		src = dst;
+		dst = swap;
+	}
+	free( runs_first );
+	free( scratch );
+}
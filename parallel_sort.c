@@ -0,0 +1,344 @@
+/*
+ * parallel_sort.c
+ *
+ *      Multithreaded local sort: chunks of array are sorted by worker threads, then sorted
+ *      chunks are merged pairwise, each pair merge is splitted by merge path into equal
+ *      pieces so all threads are busy at every merge round. Tasks are distributed over
+ *      per thread queues, idle thread steals tasks from queues of other threads.
+ *      K-way merge of sorted runs is parallelized the same way: output is splitted into
+ *      pieces by co-ranking binary searches & every piece is merged independently.
+ */
+
+#include "sort.h"
+#include <stdlib.h>
+#include <unistd.h> //sysconf()
+#include <pthread.h>
+
+/*Tasks count per thread on every phase, more tasks is better balance via stealing*/
+#define TASKS_PER_THREAD 4
+/*Do not split arrays into pieces less than*/
+#define MIN_TASK_ITEMS_COUNT 16384
+enum task_t { ETASK_SORT, ETASK_MERGE, ETASK_MULTIWAY_MERGE };
+
+/*Pieces of runs merged by one ETASK_MULTIWAY_MERGE task*/
+struct multiway_runs_t{
+	BigArrayPtr *runs;
+	int *runs_len;
+	int runs_count;
+};
+
+struct sort_task_t{
+	int type; //task_t enum
+	const BigArrayItem *left;
+	int left_len;
+	const BigArrayItem *right; //used by ETASK_MERGE only
+	int right_len;
+	const struct multiway_runs_t *multiway; //used by ETASK_MULTIWAY_MERGE only
+	BigArrayPtr dst;
+};
+
+struct task_queue_t{
+	pthread_mutex_t lock;
+	int head; //index of first task in pool tasks array, stealing from head
+	int tail; //index after last task, owner takes from tail
+};
+
+struct work_pool_t{
+	int threads_count;
+	pthread_t *threads;
+	struct task_queue_t *queues;
+	struct sort_task_t *tasks;
+	pthread_mutex_t lock;
+	pthread_cond_t start_cond;
+	pthread_cond_t done_cond;
+	int generation; //incremented for every phase
+	int running_workers;
+	int stop;
+};
+
+struct worker_arg_t{
+	struct work_pool_t *pool;
+	int worker_index;
+};
+
+
+static void
+run_task( const struct sort_task_t *task ){
+	if ( ETASK_SORT == task->type )
+		radix_sort( (const BigArrayPtr)task->left, task->dst, task->left_len );
+	else if ( ETASK_MULTIWAY_MERGE == task->type )
+		multiway_merge( task->dst, task->multiway->runs, task->multiway->runs_len, task->multiway->runs_count );
+	else
+		merge_into( task->dst, (const BigArrayPtr)task->left, task->left_len,
+				(const BigArrayPtr)task->right, task->right_len );
+}
+
+/*@return task index or -1 if queue is empty*/
+static int
+pop_task( struct task_queue_t *queue, int steal ){
+	int task_index = -1;
+	pthread_mutex_lock( &queue->lock );
+	if ( queue->head < queue->tail )
+		task_index = steal ? queue->head++ : --queue->tail;
+	pthread_mutex_unlock( &queue->lock );
+	return task_index;
+}
+
+/*run own tasks, then steal tasks of other workers until all queues are empty*/
+static void
+run_queues( struct work_pool_t *pool, int worker_index ){
+	int task_index;
+	while( (task_index = pop_task( &pool->queues[worker_index], 0 )) != -1 )
+		run_task( &pool->tasks[task_index] );
+	for ( int i=1; i < pool->threads_count; i++ ){
+		struct task_queue_t *victim = &pool->queues[ (worker_index+i) % pool->threads_count ];
+		while( (task_index = pop_task( victim, 1 )) != -1 )
+			run_task( &pool->tasks[task_index] );
+	}
+}
+
+static void*
+worker_thread( void *arg ){
+	struct worker_arg_t *worker = arg;
+	struct work_pool_t *pool = worker->pool;
+	int generation = 0;
+	pthread_mutex_lock( &pool->lock );
+	for(;;){
+		while( !pool->stop && generation == pool->generation )
+			pthread_cond_wait( &pool->start_cond, &pool->lock );
+		if ( pool->stop ) break;
+		generation = pool->generation;
+		pthread_mutex_unlock( &pool->lock );
+
+		run_queues( pool, worker->worker_index );
+
+		pthread_mutex_lock( &pool->lock );
+		if ( !--pool->running_workers )
+			pthread_cond_signal( &pool->done_cond );
+	}
+	pthread_mutex_unlock( &pool->lock );
+	return NULL;
+}
+
+static void
+init_pool( struct work_pool_t *pool, struct worker_arg_t *args, int threads_count ){
+	pool->threads_count = threads_count;
+	pool->threads = malloc( sizeof(pthread_t)*threads_count );
+	pool->queues = malloc( sizeof(struct task_queue_t)*threads_count );
+	pool->tasks = NULL;
+	pool->generation = 0;
+	pool->running_workers = 0;
+	pool->stop = 0;
+	pthread_mutex_init( &pool->lock, NULL );
+	pthread_cond_init( &pool->start_cond, NULL );
+	pthread_cond_init( &pool->done_cond, NULL );
+	for ( int i=0; i < threads_count; i++ )
+		pthread_mutex_init( &pool->queues[i].lock, NULL );
+	/*caller thread is worker 0*/
+	for ( int i=1; i < threads_count; i++ ){
+		args[i].pool = pool;
+		args[i].worker_index = i;
+		pthread_create( &pool->threads[i], NULL, worker_thread, &args[i] );
+	}
+}
+
+static void
+destroy_pool( struct work_pool_t *pool ){
+	pthread_mutex_lock( &pool->lock );
+	pool->stop = 1;
+	pthread_cond_broadcast( &pool->start_cond );
+	pthread_mutex_unlock( &pool->lock );
+	for ( int i=1; i < pool->threads_count; i++ )
+		pthread_join( pool->threads[i], NULL );
+	for ( int i=0; i < pool->threads_count; i++ )
+		pthread_mutex_destroy( &pool->queues[i].lock );
+	pthread_mutex_destroy( &pool->lock );
+	pthread_cond_destroy( &pool->start_cond );
+	pthread_cond_destroy( &pool->done_cond );
+	free( pool->queues );
+	free( pool->threads );
+}
+
+/*distribute tasks by equal contiguous parts over workers queues and run it, return when all done*/
+static void
+pool_run_tasks( struct work_pool_t *pool, struct sort_task_t *tasks, int tasks_count ){
+	pthread_mutex_lock( &pool->lock );
+	pool->tasks = tasks;
+	for ( int i=0; i < pool->threads_count; i++ ){
+		pool->queues[i].head = (long long)tasks_count * i / pool->threads_count;
+		pool->queues[i].tail = (long long)tasks_count * (i+1) / pool->threads_count;
+	}
+	pool->running_workers = pool->threads_count-1;
+	pool->generation++;
+	pthread_cond_broadcast( &pool->start_cond );
+	pthread_mutex_unlock( &pool->lock );
+
+	run_queues( pool, 0 );
+
+	pthread_mutex_lock( &pool->lock );
+	while( pool->running_workers > 0 )
+		pthread_cond_wait( &pool->done_cond, &pool->lock );
+	pthread_mutex_unlock( &pool->lock );
+}
+
+
+/**Merge path: find split of two sorted arrays for output diagonal, all merged items before
+ * diagonal are left[0..result) and right[0..diagonal-result)
+ * @return count of left array items before diagonal*/
+int
+merge_path_split( const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len, int diagonal ){
+	int low = diagonal > right_array_len ? diagonal - right_array_len : 0;
+	int high = diagonal < left_array_len ? diagonal : left_array_len;
+	while( low < high ){
+		int middle = low + (high-low)/2;
+		/*left items are taken first if equal, as by merge_into*/
+		if ( item_less_equal( left_array[middle], right_array[diagonal-middle-1] ) )
+			low = middle+1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+
+/**Parallel sort of array by threads_count threads
+ * @param sorted_array caller provided output, array_len items
+ * @param threads_count 0 means online processors count*/
+void
+parallel_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len, int threads_count ){
+	if ( threads_count <= 0 )
+		threads_count = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	int chunks_count = threads_count * TASKS_PER_THREAD;
+	if ( chunks_count > array_len / MIN_TASK_ITEMS_COUNT )
+		chunks_count = array_len / MIN_TASK_ITEMS_COUNT;
+	if ( threads_count <= 1 || chunks_count <= 1 ){
+		radix_sort( array, sorted_array, array_len );
+		return;
+	}
+
+	int rounds = 0;
+	for ( int runs=chunks_count; runs > 1; runs=(runs+1)/2 )
+		++rounds;
+	BigArrayPtr scratch = malloc( sizeof(BigArrayItem)*array_len );
+	/*last merge round should write into sorted_array*/
+	BigArrayPtr src = rounds%2 ? scratch : sorted_array;
+	BigArrayPtr dst = rounds%2 ? sorted_array : scratch;
+
+	struct work_pool_t pool;
+	struct worker_arg_t args[threads_count];
+	init_pool( &pool, args, threads_count );
+	/*merge of every runs pair is splitted into pieces of this size*/
+	const int piece_len = array_len / chunks_count + 1;
+	struct sort_task_t *tasks = malloc( sizeof(struct sort_task_t)*(chunks_count*2+1) );
+
+	/*sort chunks, runs[i] is first item index of run i*/
+	int runs[chunks_count+1];
+	for ( int i=0; i <= chunks_count; i++ )
+		runs[i] = (long long)array_len * i / chunks_count;
+	for ( int i=0; i < chunks_count; i++ ){
+		tasks[i].type = ETASK_SORT;
+		tasks[i].left = array + runs[i];
+		tasks[i].left_len = runs[i+1] - runs[i];
+		tasks[i].dst = src + runs[i];
+	}
+	pool_run_tasks( &pool, tasks, chunks_count );
+
+	/*merge rounds, odd run is copied to next round as merge with empty right run*/
+	int runs_count = chunks_count;
+	while( runs_count > 1 ){
+		int tasks_count = 0;
+		int next_runs_count = 0;
+		for ( int r=0; r < runs_count; r+=2 ){
+			const BigArrayPtr left = src + runs[r];
+			const int left_len = runs[r+1] - runs[r];
+			const BigArrayPtr right = src + runs[r+1];
+			const int right_len = r+1 < runs_count ? runs[r+2] - runs[r+1] : 0;
+			const int merged_len = left_len + right_len;
+			int left_index = 0;
+			for ( int diagonal = 0; diagonal < merged_len; ){
+				int next_diagonal = diagonal + piece_len < merged_len ? diagonal + piece_len : merged_len;
+				int next_left_index =
+						merge_path_split( left, left_len, right, right_len, next_diagonal );
+				tasks[tasks_count].type = ETASK_MERGE;
+				tasks[tasks_count].left = left + left_index;
+				tasks[tasks_count].left_len = next_left_index - left_index;
+				tasks[tasks_count].right = right + (diagonal - left_index);
+				tasks[tasks_count].right_len = (next_diagonal - next_left_index) - (diagonal - left_index);
+				tasks[tasks_count].dst = dst + runs[r] + diagonal;
+				tasks_count++;
+				diagonal = next_diagonal;
+				left_index = next_left_index;
+			}
+			runs[next_runs_count++] = runs[r];
+		}
+		runs[next_runs_count] = array_len;
+		pool_run_tasks( &pool, tasks, tasks_count );
+		runs_count = next_runs_count;
+		BigArrayPtr swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	destroy_pool( &pool );
+	free( tasks );
+	free( scratch );
+}
+
+
+/**Parallel k-way merge of sorted runs by threads_count threads, output is splitted into
+ * equal pieces by multiway_merge_split, result is the same as of multiway_merge.
+ * @param threads_count 0 means online processors count*/
+void
+parallel_multiway_merge( BigArrayPtr dst_array, const BigArrayPtr *runs, const int *runs_len, int runs_count,
+		int threads_count ){
+	if ( threads_count <= 0 )
+		threads_count = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	int array_len = 0;
+	for ( int i=0; i < runs_count; i++ )
+		array_len += runs_len[i];
+	int pieces_count = threads_count * TASKS_PER_THREAD;
+	if ( pieces_count > array_len / MIN_TASK_ITEMS_COUNT )
+		pieces_count = array_len / MIN_TASK_ITEMS_COUNT;
+	if ( threads_count <= 1 || pieces_count <= 1 ){
+		multiway_merge( dst_array, runs, runs_len, runs_count );
+		return;
+	}
+
+	/*splits of piece p are splits[p*runs_count .. (p+1)*runs_count)*/
+	int *splits = malloc( sizeof(int)*(pieces_count+1)*runs_count );
+	int ranks[pieces_count+1];
+	for ( int p=0; p <= pieces_count; p++ ){
+		ranks[p] = (long long)array_len * p / pieces_count;
+		multiway_merge_split( runs, runs_len, runs_count, ranks[p], splits + p*runs_count );
+	}
+	struct sort_task_t *tasks = malloc( sizeof(struct sort_task_t)*pieces_count );
+	struct multiway_runs_t *pieces = malloc( sizeof(struct multiway_runs_t)*pieces_count );
+	BigArrayPtr *pieces_runs = malloc( sizeof(BigArrayPtr)*pieces_count*runs_count );
+	int *pieces_runs_len = malloc( sizeof(int)*pieces_count*runs_count );
+	for ( int p=0; p < pieces_count; p++ ){
+		const int *first = splits + p*runs_count;
+		const int *last = splits + (p+1)*runs_count;
+		pieces[p].runs = pieces_runs + p*runs_count;
+		pieces[p].runs_len = pieces_runs_len + p*runs_count;
+		pieces[p].runs_count = runs_count;
+		for ( int i=0; i < runs_count; i++ ){
+			pieces[p].runs[i] = runs[i] + first[i];
+			pieces[p].runs_len[i] = last[i] - first[i];
+		}
+		tasks[p].type = ETASK_MULTIWAY_MERGE;
+		tasks[p].multiway = &pieces[p];
+		tasks[p].dst = dst_array + ranks[p];
+	}
+
+	struct work_pool_t pool;
+	struct worker_arg_t args[threads_count];
+	init_pool( &pool, args, threads_count );
+	pool_run_tasks( &pool, tasks, pieces_count );
+	destroy_pool( &pool );
+	free( tasks );
+	free( pieces );
+	free( pieces_runs );
+	free( pieces_runs_len );
+	free( splits );
+}
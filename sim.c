@@ -0,0 +1,413 @@
+/*
+ * sim.c
+ *
+ *      Offline simulator of splitters search & exchange of distributed sort at large nodes count.
+ *      Sources are sorted arrays in memory of single process, manager runs the real splitters code
+ *      of splitter.c, detailed histograms, rank & radix count queries are answered by in-memory channel
+ *      instead of zeromq by the same answers code as source nodes use.
+ *      Reports rounds & bytes of every phase, partitions balance and exchange time modeled by
+ *      SIM_LINK_BANDWIDTH & SIM_LINK_LATENCY. Every splitters mode of main.c is simulated.
+ *      Usage: sort_merge_sim [nodes_count] [items_count] [uniform|duplicates|hotkey]
+ *             [histograms|bisection|sampling|epsilon|radix|decentralized] [seed]
+ */
+
+#include "sort.h"
+#include "splitter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h> //gettimeofday
+
+/*Defaults of command line*/
+#define SIM_NODES_COUNT 100
+#define SIM_ITEMS_COUNT 100000
+#define SIM_SEED 1 /*the same seed gives the same sources data*/
+/*Distinct keys count of duplicates distribution, hotkey distribution has SIM_HOTKEY_PERCENT items of one key*/
+#define SIM_DUPLICATE_KEYS 50
+#define SIM_HOTKEY_PERCENT 60
+/*Network model: every node has full duplex link, message costs SIM_LINK_LATENCY seconds*/
+#define SIM_LINK_BANDWIDTH 1.25e9 /*bytes per second, 10 Gbit/s*/
+#define SIM_LINK_LATENCY 0.0001
+
+enum sim_distribution_t { EDISTRIBUTION_UNIFORM, EDISTRIBUTION_DUPLICATES, EDISTRIBUTION_HOTKEY };
+/*Splitters modes as in main.c*/
+enum sim_mode_t { EMODE_HISTOGRAMS, EMODE_BISECTION, EMODE_SAMPLING, EMODE_EPSILON, EMODE_RADIX,
+	EMODE_DECENTRALIZED };
+/*EPHASE_QUERIES - detailed histograms, rank queries or radix counts of manager*/
+enum sim_phase_t { EPHASE_HISTOGRAMS, EPHASE_QUERIES, EPHASE_RANGES, EPHASE_EXCHANGE, EPHASE_COUNT };
+
+/*Traffic of phase, bytes are counted on link of manager for splitters phases*/
+struct sim_phase_stat_t{
+	const char *name;
+	int rounds;
+	long long bytes;
+	double modeled_time;
+};
+
+/*In-memory sources, it's context of simulated channel*/
+struct sim_t{
+	int nodes_count;
+	int items_count;
+	BigArrayPtr *arrays; //sorted array of every source
+	struct node_pid_t *child;
+	struct sim_phase_stat_t phases[EPHASE_COUNT];
+};
+
+
+static double
+sim_time_seconds(){
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+static int
+sim_source_index( const struct sim_t *sim, pid_t src_pid ){
+	for ( int s=0; s < sim->nodes_count; s++ )
+		if ( sim->child[s].src_node_pid == src_pid )
+			return s;
+	fprintf( stderr, "sim_source_index: unknown source %d\n", (int)src_pid );
+	exit(-1);
+}
+
+
+/*Manager link is sending & receiving messages of all sources, round costs latency of slowest source*/
+static void
+sim_phase_add_round( struct sim_phase_stat_t *phase, long long bytes ){
+	phase->rounds++;
+	phase->bytes += bytes;
+	phase->modeled_time += SIM_LINK_LATENCY + bytes / SIM_LINK_BANDWIDTH;
+}
+
+
+/*In-memory version of zeromq channel of main.c, detailed histogram is made like source node makes it*/
+struct Histogram*
+channel_request_response_detailed_histograms_alloc_get_len(void *context, const struct request_data_t* request_data,
+		int request_array_len, int complete ){
+	struct sim_t *sim = context;
+	struct Histogram* detailed_histograms = malloc( sizeof(struct Histogram)*request_array_len );
+	long long bytes = 0;
+	for( int i=0; i < request_array_len; i++ ){
+		const int s = sim_source_index( sim, request_data[i].dst_pid );
+		int offset = min( request_data[i].first_item_index, sim->items_count-1 );
+		int requested_length = request_data[i].last_item_index - request_data[i].first_item_index;
+		requested_length = min( requested_length, sim->items_count - offset );
+		int histogram_len;
+		detailed_histograms[i].array = alloc_histogram_array_get_len( sim->arrays[s], offset, requested_length, 1,
+				&histogram_len );
+		detailed_histograms[i].array_len = histogram_len;
+		detailed_histograms[i].src_pid = sim->child[s].src_node_pid;
+
+		size_t encoded_size;
+		free( alloc_histogram_encode_get_size( detailed_histograms[i].array, histogram_len, &encoded_size ) );
+		bytes += sizeof(struct request_data_t) + sizeof(complete) + sizeof(pid_t) + encoded_size;
+	}
+	sim_phase_add_round( &sim->phases[EPHASE_QUERIES], bytes );
+	return detailed_histograms;
+}
+
+
+/*In-memory rank queries, sources answer like channel_recv_rank_queries of main.c*/
+void
+channel_request_rank_counts( void *context, const pid_t *src_pids, int sources_count, const SortKey *pivots,
+		int pivots_count, int complete, struct rank_count_t *counts, BigArrayItem *items ){
+	struct sim_t *sim = context;
+	long long bytes = 0;
+	for ( int i=0; i < sources_count; i++ ){
+		const int s = sim_source_index( sim, src_pids[i] );
+		rank_query_counts( sim->arrays[s], sim->items_count, pivots, pivots_count, counts + i*pivots_count,
+				complete && items ? items + i*pivots_count : NULL );
+		bytes += sizeof(complete) + sizeof(SortKey)*pivots_count + sizeof(struct rank_count_t)*pivots_count;
+		if ( complete )
+			bytes += sizeof(BigArrayItem)*pivots_count;
+	}
+	sim_phase_add_round( &sim->phases[EPHASE_QUERIES], bytes );
+}
+
+
+/*In-memory radix count queries, sources answer like channel_recv_radix_count_queries of main.c*/
+struct radix_counts_t*
+channel_request_radix_counts_alloc( void *context, const pid_t *src_pids, int sources_count,
+		const struct radix_query_t *queries, int queries_count, int complete ){
+	struct sim_t *sim = context;
+	struct radix_counts_t *answers = queries_count ?
+			malloc( sizeof(struct radix_counts_t)*queries_count*sources_count ) : NULL;
+	struct radix_count_t *counts = malloc( sizeof(struct radix_count_t)*RADIX_SPLITTER_BUCKETS );
+	long long bytes = 0;
+	for ( int i=0; i < sources_count; i++ ){
+		const int s = sim_source_index( sim, src_pids[i] );
+		bytes += sizeof(complete) + sizeof(struct radix_query_t)*queries_count;
+		for ( int q=0; q < queries_count; q++ ){
+			struct radix_counts_t *answer = &answers[q*sources_count+i];
+			answer->array_len = radix_query_counts( sim->arrays[s], sim->items_count, &queries[q], counts );
+			answer->array = malloc( sizeof(struct radix_count_t)*max( answer->array_len, 1 ) );
+			memcpy( answer->array, counts, sizeof(struct radix_count_t)*answer->array_len );
+			bytes += sizeof(int) + (RADIX_COUNTS_DENSE(answer->array_len) ?
+					sizeof(int)*RADIX_SPLITTER_BUCKETS : sizeof(struct radix_count_t)*answer->array_len);
+		}
+	}
+	free( counts );
+	sim_phase_add_round( &sim->phases[EPHASE_QUERIES], bytes );
+	return answers;
+}
+
+
+static void
+sim_fill_sources( struct sim_t *sim, int distribution, unsigned seed ){
+	const int len = sim->nodes_count;
+	BigArrayPtr items = alloc_array_fill_random_seed( sim->items_count*len, seed );
+	struct sort_params_t params;
+	params.engine = ESORT_RADIX;
+	params.threads_count = 0;
+	params.runs_count = 0;
+	sim->arrays = malloc( sizeof(BigArrayPtr)*len );
+	for ( int s=0; s < len; s++ ){
+		BigArrayPtr array = items + (size_t)s*sim->items_count;
+		/*items of random array are used as pool of keys*/
+		for ( int i=0; i < sim->items_count; i++ ){
+			if ( EDISTRIBUTION_DUPLICATES == distribution )
+				array[i] = items[ rand() % SIM_DUPLICATE_KEYS ];
+			else if ( EDISTRIBUTION_HOTKEY == distribution && rand() % 100 < SIM_HOTKEY_PERCENT )
+				array[i] = items[0];
+		}
+		sim->arrays[s] = alloc_sort( &params, array, sim->items_count );
+	}
+	free( items );
+}
+
+
+static void
+sim_recv_histograms( struct sim_t *sim, int step, struct Histogram *histograms ){
+	long long bytes = 0;
+	for ( int s=0; s < sim->nodes_count; s++ ){
+		int histogram_len;
+		histograms[s].array = alloc_histogram_array_get_len( sim->arrays[s], 0, sim->items_count, step,
+				&histogram_len );
+		histograms[s].array_len = histogram_len;
+		histograms[s].src_pid = sim->child[s].src_node_pid;
+		size_t encoded_size;
+		free( alloc_histogram_encode_get_size( histograms[s].array, histogram_len, &encoded_size ) );
+		bytes += sizeof(struct histogram_header_t) + encoded_size;
+	}
+	sim_phase_add_round( &sim->phases[EPHASE_HISTOGRAMS], bytes );
+}
+
+
+/*Every source of all-gather sends own samples to all other sources, node link limits it*/
+static void
+sim_allgather_samples( struct sim_t *sim, const struct Histogram *histograms ){
+	const int len = sim->nodes_count;
+	long long *sizes = malloc( sizeof(long long)*len );
+	long long total = 0, max_node = 0;
+	for ( int s=0; s < len; s++ ){
+		size_t encoded_size;
+		free( alloc_histogram_encode_get_size( histograms[s].array, histograms[s].array_len, &encoded_size ) );
+		sizes[s] = sizeof(struct histogram_header_t) + encoded_size;
+		total += sizes[s];
+	}
+	/*full duplex link of node sends own samples & receives samples of others*/
+	for ( int s=0; s < len; s++ )
+		max_node = max( max_node, max( sizes[s]*(len-1), total - sizes[s] ) );
+	free( sizes );
+	struct sim_phase_stat_t *phase = &sim->phases[EPHASE_HISTOGRAMS];
+	phase->rounds = 1;
+	phase->bytes = total*(len-1);
+	phase->modeled_time = SIM_LINK_LATENCY + max_node / SIM_LINK_BANDWIDTH;
+}
+
+
+/*Sources cut ranges by splitters like every source does it, result has layout of histograms mode*/
+static struct request_data_t**
+sim_alloc_range_request_key_splitters( struct sim_t *sim, const struct key_splitter_t *splitters ){
+	const int len = sim->nodes_count;
+	pid_t *dst_pids = malloc( sizeof(pid_t)*len );
+	for ( int d=0; d < len; d++ )
+		dst_pids[d] = sim->child[d].dst_node_pid;
+	struct request_data_t *sequence = malloc( sizeof(struct request_data_t)*len );
+	struct request_data_t **range = malloc( sizeof(struct request_data_t*)*len );
+	for ( int d=0; d < len; d++ )
+		range[d] = malloc( sizeof(struct request_data_t)*len );
+	for ( int s=0; s < len; s++ ){
+		key_splitters_get_ranges( sim->arrays[s], sim->items_count, sim->child[s].src_node_pid, splitters,
+				dst_pids, sequence, len );
+		for ( int d=0; d < len; d++ )
+			range[d][s] = sequence[d];
+	}
+	free( sequence );
+	free( dst_pids );
+	return range;
+}
+
+
+/**Check that ranges cover every source & partitions are ordered, account exchange traffic
+ * @return 1 if test ok*/
+static int
+sim_exchange( struct sim_t *sim, struct request_data_t **range, double *balance ){
+	const int len = sim->nodes_count;
+	int test_ok = 1;
+	long long max_partition = 0, total = 0;
+	SortKey prev_max = 0;
+	int prev_nonempty = 0;
+	for ( int d=0; d < len; d++ ){
+		long long partition = 0;
+		SortKey min_key = 0, max_key = 0;
+		int nonempty = 0;
+		for ( int s=0; s < len; s++ ){
+			const struct request_data_t *r = &range[d][s];
+			int expected_first = d ? range[d-1][s].last_item_index+1 : 0;
+			if ( r->first_item_index != expected_first || r->last_item_index < r->first_item_index-1 )
+				test_ok = 0;
+			int count = r->last_item_index - r->first_item_index + 1;
+			if ( count <= 0 ) continue;
+			SortKey first_key = item_key( sim->arrays[s][r->first_item_index] );
+			SortKey last_key = item_key( sim->arrays[s][r->last_item_index] );
+			if ( !nonempty || first_key < min_key ) min_key = first_key;
+			if ( !nonempty || last_key > max_key ) max_key = last_key;
+			nonempty = 1;
+			partition += count;
+		}
+		if ( nonempty ){
+			/*neighbour partitions can share boundary key*/
+			if ( prev_nonempty && prev_max > min_key )
+				test_ok = 0;
+			prev_max = max_key;
+			prev_nonempty = 1;
+		}
+		max_partition = max( max_partition, partition );
+		total += partition;
+	}
+	for ( int s=0; s < len; s++ )
+		if ( range[len-1][s].last_item_index != sim->items_count-1 )
+			test_ok = 0;
+	if ( total != (long long)sim->items_count*len )
+		test_ok = 0;
+	*balance = (double)max_partition*len/max( total, 1LL );
+
+	/*every source sends whole array, the most loaded destination limits exchange*/
+	struct sim_phase_stat_t *exchange = &sim->phases[EPHASE_EXCHANGE];
+	exchange->rounds = 1;
+	exchange->bytes = total*sizeof(BigArrayItem);
+	exchange->modeled_time = SIM_LINK_LATENCY +
+			max( (long long)sim->items_count, max_partition )*sizeof(BigArrayItem) / SIM_LINK_BANDWIDTH;
+	return test_ok;
+}
+
+
+int
+main( int argc, char **argv ){
+	const char *distributions[] = { "uniform", "duplicates", "hotkey" };
+	const char *modes[] = { "histograms", "bisection", "sampling", "epsilon", "radix", "decentralized" };
+	int nodes_count = argc > 1 ? atoi( argv[1] ) : SIM_NODES_COUNT;
+	int items_count = argc > 2 ? atoi( argv[2] ) : SIM_ITEMS_COUNT;
+	int distribution = EDISTRIBUTION_UNIFORM;
+	int mode = EMODE_HISTOGRAMS;
+	unsigned seed = argc > 5 ? (unsigned)strtoul( argv[5], NULL, 10 ) : SIM_SEED;
+	for ( int i=0; argc > 3 && i < sizeof(distributions)/sizeof(*distributions); i++ )
+		if ( !strcmp( argv[3], distributions[i] ) )
+			distribution = i;
+	for ( int i=0; argc > 4 && i < sizeof(modes)/sizeof(*modes); i++ )
+		if ( !strcmp( argv[4], modes[i] ) )
+			mode = i;
+	if ( nodes_count < 2 || items_count < 1 || (long long)nodes_count*items_count > 0x7FFFFFFF ){
+		printf( "Usage: %s [nodes_count] [items_count] [uniform|duplicates|hotkey]\n"
+				"\t[histograms|bisection|sampling|epsilon|radix|decentralized] [seed]\n", argv[0] );
+		return -1;
+	}
+	const int sampling = EMODE_SAMPLING == mode || EMODE_DECENTRALIZED == mode;
+
+	struct sim_t sim;
+	memset( &sim, 0, sizeof(sim) );
+	sim.nodes_count = nodes_count;
+	sim.items_count = items_count;
+	sim.phases[EPHASE_HISTOGRAMS].name = EMODE_DECENTRALIZED == mode ? "samples all-gather" : "histograms";
+	sim.phases[EPHASE_QUERIES].name = EMODE_RADIX == mode ? "radix counts" :
+			EMODE_HISTOGRAMS == mode ? "detailed histograms" : sampling ? "queries" : "rank queries";
+	sim.phases[EPHASE_RANGES].name = EMODE_DECENTRALIZED == mode ? "pids table" :
+			sampling || EMODE_EPSILON == mode ? "splitters" : "range requests";
+	sim.phases[EPHASE_EXCHANGE].name = "exchange";
+	sim.child = malloc( sizeof(struct node_pid_t)*nodes_count );
+	for ( int i=0; i < nodes_count; i++ ){
+		sim.child[i].src_node_pid = i+1;
+		sim.child[i].dst_node_pid = nodes_count+i+1;
+	}
+	/*coarse histograms step is the same as in main.c, radix mode has no histograms*/
+	int step = sampling ? max( items_count/nodes_count, 1 ) : HISTOGRAM_STEP;
+	printf( "Simulation: nodes=%d, items per node=%d, distribution=%s, splitters=%s, histogram step=%d, seed=%u\n",
+			nodes_count, items_count, distributions[distribution], modes[mode], EMODE_RADIX == mode ? 0 : step, seed );
+	fflush(0);
+	sim_fill_sources( &sim, distribution, seed );
+
+	struct Histogram *histograms = malloc( sizeof(struct Histogram)*nodes_count );
+	for ( int s=0; s < nodes_count; s++ )
+		histograms[s].array = NULL;
+	if ( EMODE_RADIX != mode )
+		sim_recv_histograms( &sim, step, histograms );
+	double splitters_time = sim_time_seconds();
+	struct request_data_t **range;
+	if ( sampling || EMODE_EPSILON == mode ){
+		struct key_splitter_t *splitters = malloc( sizeof(struct key_splitter_t)*nodes_count );
+		if ( EMODE_EPSILON == mode )
+			epsilon_key_splitters( &sim, items_count, histograms, nodes_count, splitters );
+		else
+			sampling_splitters( histograms, nodes_count, splitters );
+		range = sim_alloc_range_request_key_splitters( &sim, splitters );
+		free( splitters );
+		if ( EMODE_DECENTRALIZED == mode ){
+			/*samples are all-gathered by sources instead of sending it to manager,
+			 *manager only sends pids table to every source*/
+			sim_allgather_samples( &sim, histograms );
+			sim_phase_add_round( &sim.phases[EPHASE_RANGES],
+					(long long)nodes_count*nodes_count*sizeof(struct node_pid_t) );
+		}
+		else
+			/*every source gets splitters & destinations pids*/
+			sim_phase_add_round( &sim.phases[EPHASE_RANGES],
+					(long long)nodes_count*((nodes_count-1)*sizeof(struct key_splitter_t) + nodes_count*sizeof(pid_t)) );
+	}
+	else{
+		if ( EMODE_BISECTION == mode )
+			range = alloc_range_request_bisect_ranks( &sim, items_count, histograms, nodes_count,
+					sim.child, nodes_count );
+		else if ( EMODE_RADIX == mode )
+			range = alloc_range_request_radix_counts( &sim, items_count, sim.child, nodes_count );
+		else
+			range = alloc_range_request_analize_histograms( &sim, items_count, histograms, nodes_count,
+					sim.child, nodes_count );
+		/*every source gets its ranges for all destinations*/
+		sim_phase_add_round( &sim.phases[EPHASE_RANGES],
+				(long long)nodes_count*nodes_count*sizeof(struct request_data_t) );
+	}
+	splitters_time = sim_time_seconds() - splitters_time;
+	if ( !range ){
+		printf( "Histograms walk failed: nodes=%d, histogram step=%d, distribution=%s, sampling splitters fit it\n",
+				nodes_count, step, distributions[distribution] );
+		printf( "Simulation complete, Test 0\n" );
+		return -1;
+	}
+
+	double balance;
+	int test_ok = sim_exchange( &sim, range, &balance );
+	double modeled_total = 0;
+	for ( int p=0; p < EPHASE_COUNT; p++ ){
+		printf( "Phase %s: rounds=%d, bytes=%lld, modeled time=%.4fs\n", sim.phases[p].name,
+				sim.phases[p].rounds, sim.phases[p].bytes, sim.phases[p].modeled_time );
+		modeled_total += sim.phases[p].modeled_time;
+	}
+	printf( "Splitters search cpu time=%.3fs, modeled total time=%.4fs\n", splitters_time, modeled_total );
+	printf( "Partitions balance max/avg=%.4f\n", balance );
+	printf( "Simulation complete, Test %d\n", test_ok );
+
+	for ( int d=0; d < nodes_count; d++ )
+		free( range[d] );
+	free( range );
+	for ( int s=0; s < nodes_count; s++ ){
+		free( histograms[s].array );
+		free( sim.arrays[s] );
+	}
+	free( histograms );
+	free( sim.arrays );
+	free( sim.child );
+	return 0;
+}
@@ -10,12 +10,26 @@
 #include "sort.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <sys/types.h> //pid_t
-#include <unistd.h> //getpid()
+#include <unistd.h> //getpid(), sysconf()
+
+
+/*LSD radix sort digit width in bits, 4 passes for 32-bit SortKey, 8 passes for 64-bit*/
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1<<RADIX_BITS)
+#define RADIX_PASSES ((int)(sizeof(SortKey)*8/RADIX_BITS))
+/*Sort engine autotuner settings*/
+#define AUTOTUNE_SMALL_ARRAY_LEN 4096
+#define AUTOTUNE_PARALLEL_ARRAY_LEN (256*1024)
+#define AUTOTUNE_SAMPLE_LEN 1024
+#define AUTOTUNE_WINDOWS_COUNT 16
+#define AUTOTUNE_WINDOW_LEN 64
+#define AUTOTUNE_PRESORTED_PERCENT 90
+#define AUTOTUNE_DUPLICATES_PERCENT 50
+#define AUTOTUNE_RADIX_KEY_BITS 16
 
-
-void copy_array( BigArrayPtr dst_array, const BigArrayPtr src_array, int array_len );
 BigArrayPtr alloc_copy_array( const BigArrayPtr array, int array_len );
 
 
@@ -23,51 +37,148 @@ BigArrayPtr alloc_copy_array( const BigArrayPtr array, int array_len );
 void
 print_histogram( const HistogramArrayPtr histogram, size_t len ){
 	for ( int j=0; j < len && j < 20; j++ ){
-		printf( "[%d]=[%d, %d), ",
-				histogram[j].item, histogram[j].item_index, (int)histogram[j].last_item_index );
+		printf( "[%llu]=[%d, %d), ",
+				(unsigned long long)histogram[j].item, histogram[j].item_index, (int)histogram[j].last_item_index );
 	}
 	fflush(0);
 }
 
 
+/*Layout of histogram item h: it's array item offset+h*step, sampling step items*/
+static inline void
+histogram_item_set_indexes( HistogramArrayItem *histogram_item, int offset, int step, int h ){
+	histogram_item->item_index = offset + h*step;
+	histogram_item->last_item_index = histogram_item->item_index + step -1;
+}
+
+
 HistogramArrayPtr
 alloc_histogram_array_get_len(
 		const BigArrayPtr array, int offset, const int array_len, int step, int *histogram_len ){
 	*histogram_len = array_len/step;
 	if ( *histogram_len * step < array_len )
 		++*histogram_len;
-	int h = 0, i = 0;
-	HistogramArrayItem histogram_item;
 	HistogramArrayPtr histogram_array = malloc( sizeof(HistogramArrayItem) * *histogram_len );
-	for( i=0, h=0; i < array_len && h < *histogram_len; i+=step ){
-		histogram_item.item_index = i+offset;
-		histogram_item.item = array[i+offset];
-		histogram_item.last_item_index = histogram_item.item_index + step -1;
-		histogram_array[h++] = histogram_item;
-	}
-	//add histogram item with histogram_step < step
-	if ( histogram_item.item_index < array_len-1 && h < *histogram_len ){
-		histogram_item.item_index = offset+ array_len-1;
-		histogram_item.item = array[offset+array_len-1];
-		histogram_item.last_item_index = histogram_item.item_index + array_len-1-i-1;
-		histogram_array[h] = histogram_item;
+	for( int h=0; h < *histogram_len; h++ ){
+		histogram_item_set_indexes( &histogram_array[h], offset, step, h );
+		histogram_array[h].item = item_key( array[histogram_array[h].item_index] );
+	}
+	return histogram_array;
+}
+
+
+static uint8_t*
+varint_encode( uint8_t *encoded, SortKey value ){
+	while( value >= 0x80 ){
+		*encoded++ = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	*encoded++ = (uint8_t)value;
+	return encoded;
+}
+
+
+static const uint8_t*
+varint_decode( const uint8_t *encoded, const uint8_t *end, SortKey *value ){
+	SortKey result = 0;
+	for ( int shift=0; encoded < end; shift+=7 ){
+		uint8_t byte = *encoded++;
+		result |= (SortKey)(byte & 0x7f) << shift;
+		if ( !(byte & 0x80) ) break;
+	}
+	*value = result;
+	return encoded;
+}
+
+
+uint8_t*
+alloc_histogram_encode_get_size( const HistogramArrayPtr histogram, int histogram_len, size_t *size ){
+	struct histogram_header_t header;
+	header.offset = histogram_len ? histogram[0].item_index : 0;
+	header.step = histogram_len ? histogram[0].last_item_index - histogram[0].item_index + 1 : 1;
+	header.count = histogram_len;
+	/*varint of SortKey takes up to 10 bytes*/
+	uint8_t *encoded = malloc( sizeof(header) + histogram_len*(sizeof(SortKey)*8/7+1) );
+	memcpy( encoded, &header, sizeof(header) );
+	uint8_t *current = encoded + sizeof(header);
+	SortKey previous = 0;
+	for ( int h=0; h < histogram_len; h++ ){
+		/*keys of sorted array are not descending, so deltas are small & not negative*/
+		current = varint_encode( current, histogram[h].item - previous );
+		previous = histogram[h].item;
+	}
+	*size = current - encoded;
+	return encoded;
+}
+
+
+HistogramArrayPtr
+alloc_histogram_decode_get_len( const uint8_t *encoded, size_t size, int *histogram_len ){
+	struct histogram_header_t header;
+	if ( size < sizeof(header) ){
+		*histogram_len = 0;
+		return NULL;
+	}
+	memcpy( &header, encoded, sizeof(header) );
+	const uint8_t *current = encoded + sizeof(header);
+	const uint8_t *end = encoded + size;
+	HistogramArrayPtr histogram_array = malloc( sizeof(HistogramArrayItem) * header.count );
+	SortKey previous = 0;
+	for ( int h=0; h < header.count; h++ ){
+		SortKey delta;
+		current = varint_decode( current, end, &delta );
+		histogram_item_set_indexes( &histogram_array[h], header.offset, header.step, h );
+		histogram_array[h].item = previous += delta;
 	}
+	*histogram_len = header.count;
 	return histogram_array;
 }
 
+
+/*random item of BIG_ARRAY_ITEM_TYPE, signed & floating point items are spread around zero*/
+static BigArrayItem
+random_item(){
+	BigArrayItem item;
+#if BIG_ARRAY_ITEM_TYPE == ITEM_UINT32
+	item = rand();
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_INT32
+	item = rand() - RAND_MAX/2;
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_FLOAT || BIG_ARRAY_ITEM_TYPE == ITEM_DOUBLE
+	item = ((double)rand() / RAND_MAX - 0.5) * 1e6;
+#else
+	/*64-bit keys are made of 3 rand() values*/
+	uint64_t bits = ((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ (uint64_t)rand();
+#if BIG_ARRAY_ITEM_TYPE == ITEM_UINT64
+	item = bits;
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_INT64
+	item = (int64_t)bits;
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_RECORD
+	item.key = bits;
+	memset( item.payload, (int)(bits & 0xFF), sizeof(item.payload) );
+#endif
+#endif
+	return item;
+}
+
+/*the same seed gives the same array, rand() sequence is continued after it*/
 BigArrayPtr
-alloc_array_fill_random( int array_len ){
+alloc_array_fill_random_seed( int array_len, unsigned seed ){
 	BigArrayPtr unsorted_array = malloc( sizeof(BigArrayItem)*array_len );
 
-	pid_t pid = getpid();
 	//fill array by random numbers
-	srand((time_t)pid );
+	srand( seed );
 	for (int i=0; i<array_len; i++){
-		unsorted_array[i]=rand();
+		unsorted_array[i]=random_item();
 	}
 	return unsorted_array;
 }
 
+/*every node process gets own data*/
+BigArrayPtr
+alloc_array_fill_random( int array_len ){
+	return alloc_array_fill_random_seed( array_len, (unsigned)getpid() );
+}
+
 
 BigArrayPtr
 alloc_merge_sort( const BigArrayPtr array, int array_len ){
@@ -89,18 +200,39 @@ BigArrayPtr
 merge(
 		const BigArrayPtr left_array, int left_array_len,
 		const BigArrayPtr right_array, int right_array_len ){
+	BigArrayPtr result = malloc( sizeof(BigArrayItem) *(left_array_len+right_array_len));
+	merge_into( result, left_array, left_array_len, right_array, right_array_len );
+	return result;
+}
+
+
+/**Merge two sorted arrays into dst_array by the best merge kernel supported by CPU,
+ * dst_array should not overlap with left_array, it can overlap right_array only if
+ * right_array == dst_array+left_array_len: items are never written ahead of read position*/
+void
+merge_into( BigArrayPtr dst_array,
+		const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len ){
+	sort_kernels()->merge( dst_array, left_array, left_array_len, right_array, right_array_len );
+}
+
+
+/**Scalar merge, it's also used by SIMD kernels to merge the rest of runs*/
+void
+merge_into_scalar( BigArrayPtr dst_array,
+		const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len ){
 	BigArrayPtr larray = left_array;
 	BigArrayPtr rarray = right_array;
-	BigArrayPtr result = malloc( sizeof(BigArrayItem) *(left_array_len+right_array_len));
 	int current_result_index = 0;
 	while ( left_array_len > 0 && right_array_len > 0 ){
-		if ( larray[0] <= rarray[0]  ){
-			result[current_result_index++] = larray[0];
+		if ( item_less_equal( larray[0], rarray[0] ) ){
+			dst_array[current_result_index++] = larray[0];
 			++larray;
 			--left_array_len;
 		}
 		else{
-			result[current_result_index++] = rarray[0];
+			dst_array[current_result_index++] = rarray[0];
 			++rarray;
 			--right_array_len;
 		}
@@ -108,19 +240,307 @@ merge(
 
 	//if merge arrays not empty then it can hold last item
 	if ( left_array_len > 0 ){
-		copy_array( result+current_result_index, larray, left_array_len );
+		copy_array( dst_array+current_result_index, larray, left_array_len );
 	}
 	if ( right_array_len > 0 ){
-		copy_array( result+current_result_index, rarray, right_array_len );
+		copy_array( dst_array+current_result_index, rarray, right_array_len );
 	}
+}
 
-	return result;
+
+void
+insertion_sort( BigArrayPtr array, int array_len ){
+	for ( int i=1; i < array_len; i++ ){
+		BigArrayItem item = array[i];
+		int j = i;
+		while ( j > 0 && item_less( item, array[j-1] ) ){
+			array[j] = array[j-1];
+			--j;
+		}
+		array[j] = item;
+	}
+}
+
+
+/**Iterative merge sort without recursion and per level allocations. Blocks are sorted by
+ * sorting network kernel, then merge passes are ping-ponged between sorted_array and scratch
+ * buffer; first pass target is choosen so that last pass always writes into sorted_array.
+ * @param sorted_array caller provided output, array_len items
+ * @param scratch caller provided buffer, array_len items*/
+void
+bottom_up_merge_sort_scratch( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		BigArrayPtr scratch ){
+	const struct sort_kernels_t *kernels = sort_kernels();
+	const int block_len = kernels->block_len;
+	int passes = 0;
+	for ( int width=block_len; width < array_len; width*=2 )
+		++passes;
+
+	BigArrayPtr src = passes%2 ? scratch : sorted_array;
+	BigArrayPtr dst = passes%2 ? sorted_array : scratch;
+	copy_array( src, array, array_len );
+	int i = 0;
+	for ( ; i+block_len <= array_len; i+=block_len )
+		kernels->sort_block( src+i );
+	insertion_sort( src+i, array_len-i );
+
+	for ( int width=block_len; width < array_len; width*=2 ){
+		for ( int i=0; i < array_len; i+=2*width ){
+			int left_len = min_len( width, array_len-i );
+			int right_len = min_len( width, array_len-i-left_len );
+			kernels->merge( dst+i, src+i, left_len, src+i+left_len, right_len );
+		}
+		BigArrayPtr swap = src;
+		src = dst;
+		dst = swap;
+	}
+}
+
+
+/**Bottom-up merge sort with single scratch buffer allocated
+ * @param sorted_array caller provided output, array_len items*/
+void
+bottom_up_merge_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len ){
+	BigArrayPtr scratch = malloc( sizeof(BigArrayItem)*array_len );
+	bottom_up_merge_sort_scratch( array, sorted_array, array_len, scratch );
+	free(scratch);
+}
+
+
+/**LSD radix sort. Histograms of all digits are counted by single read of array, digit pass
+ * is skipped if all keys share the same digit. Passes are ping-ponged between sorted_array
+ * and one scratch buffer, last pass always writes into sorted_array.
+ * @param sorted_array caller provided output, array_len items*/
+void
+radix_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len ){
+	if ( array_len <= 0 ) return;
+	int counts[RADIX_PASSES][RADIX_BUCKETS];
+	memset( counts, 0, sizeof(counts) );
+	for ( int i=0; i < array_len; i++ ){
+		SortKey key = item_key( array[i] );
+		for ( int p=0; p < RADIX_PASSES; p++ )
+			counts[p][ (key >> p*RADIX_BITS) & (RADIX_BUCKETS-1) ]++;
+	}
+
+	int passes[RADIX_PASSES];
+	int passes_count = 0;
+	for ( int p=0; p < RADIX_PASSES; p++ ){
+		if ( counts[p][ (item_key( array[0] ) >> p*RADIX_BITS) & (RADIX_BUCKETS-1) ] != array_len )
+			passes[passes_count++] = p;
+	}
+	if ( !passes_count ){
+		copy_array( sorted_array, array, array_len );
+		return;
+	}
+
+	BigArrayPtr scratch = NULL;
+	if ( passes_count > 1 )
+		scratch = malloc( sizeof(BigArrayItem)*array_len );
+	const BigArrayItem *src = array;
+	BigArrayPtr dst = passes_count%2 ? sorted_array : scratch;
+	for ( int j=0; j < passes_count; j++ ){
+		const int shift = passes[j]*RADIX_BITS;
+		int offsets[RADIX_BUCKETS];
+		int offset = 0;
+		for ( int b=0; b < RADIX_BUCKETS; b++ ){
+			offsets[b] = offset;
+			offset += counts[passes[j]][b];
+		}
+		for ( int i=0; i < array_len; i++ ){
+			dst[ offsets[ (item_key( src[i] ) >> shift) & (RADIX_BUCKETS-1) ]++ ] = src[i];
+		}
+		src = dst;
+		dst = dst == sorted_array ? scratch : sorted_array;
+	}
+	free(scratch);
+}
+
+
+/**Stable LSD radix sort of (key, original index) pairs, ties keep original order.
+ * @param sorted_array caller provided output, array_len items
+ * @param permutation caller provided output, sorted_array[i] is array[permutation[i]]*/
+void
+radix_argsort( const BigArrayPtr array, BigArrayPtr sorted_array, uint32_t *permutation, int array_len ){
+	if ( array_len <= 0 ) return;
+	struct key_index_t{ SortKey key; uint32_t index; };
+	struct key_index_t *pairs = malloc( sizeof(struct key_index_t)*array_len );
+	struct key_index_t *scratch = malloc( sizeof(struct key_index_t)*array_len );
+	int counts[RADIX_PASSES][RADIX_BUCKETS];
+	memset( counts, 0, sizeof(counts) );
+	for ( int i=0; i < array_len; i++ ){
+		pairs[i].key = item_key( array[i] );
+		pairs[i].index = i;
+		for ( int p=0; p < RADIX_PASSES; p++ )
+			counts[p][ (pairs[i].key >> p*RADIX_BITS) & (RADIX_BUCKETS-1) ]++;
+	}
+
+	for ( int p=0; p < RADIX_PASSES; p++ ){
+		if ( counts[p][ (pairs[0].key >> p*RADIX_BITS) & (RADIX_BUCKETS-1) ] == array_len )
+			continue; //all keys share the digit
+		const int shift = p*RADIX_BITS;
+		int offsets[RADIX_BUCKETS];
+		int offset = 0;
+		for ( int b=0; b < RADIX_BUCKETS; b++ ){
+			offsets[b] = offset;
+			offset += counts[p][b];
+		}
+		for ( int i=0; i < array_len; i++ )
+			scratch[ offsets[ (pairs[i].key >> shift) & (RADIX_BUCKETS-1) ]++ ] = pairs[i];
+		struct key_index_t *swap = pairs;
+		pairs = scratch;
+		scratch = swap;
+	}
+
+	for ( int i=0; i < array_len; i++ ){
+		permutation[i] = pairs[i].index;
+		sorted_array[i] = array[ pairs[i].index ];
+	}
+	free( pairs );
+	free( scratch );
+}
+
+
+static void
+sort_engine_recursive_merge( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		struct sort_params_t *params ){
+	BigArrayPtr result = alloc_merge_sort( array, array_len );
+	copy_array( sorted_array, result, array_len );
+	free( result );
+}
+
+static void
+sort_engine_bottom_up_merge( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		struct sort_params_t *params ){
+	bottom_up_merge_sort( array, sorted_array, array_len );
+}
+
+static void
+sort_engine_radix( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		struct sort_params_t *params ){
+	radix_sort( array, sorted_array, array_len );
+}
+
+static void
+sort_engine_parallel( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		struct sort_params_t *params ){
+	parallel_sort( array, sorted_array, array_len, params->threads_count );
+}
+
+static void
+sort_engine_cache_blocked( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		struct sort_params_t *params ){
+	cache_blocked_sort( array, sorted_array, array_len );
+}
+
+static void
+sort_engine_adaptive( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		struct sort_params_t *params ){
+	adaptive_sort( array, sorted_array, array_len, &params->runs_count );
+}
+
+/*Engines table, indexes are sort_t enum values*/
+static const struct sort_engine_t s_sort_engines[ESORT_COUNT] = {
+		{ "recursive-merge", sort_engine_recursive_merge },
+		{ "bottom-up-merge", sort_engine_bottom_up_merge },
+		{ "radix", sort_engine_radix },
+		{ "parallel", sort_engine_parallel },
+		{ "cache-blocked", sort_engine_cache_blocked },
+		{ "adaptive", sort_engine_adaptive }
+};
+
+
+/**@param engine sort_t enum, except ESORT_AUTO
+ * @return engine interface or NULL if engine is unknown*/
+const struct sort_engine_t*
+sort_engine( int engine ){
+	if ( engine < 0 || engine >= ESORT_COUNT )
+		return NULL;
+	return &s_sort_engines[engine];
+}
+
+
+/**Select sort engine by array size, threads budget & quick sample of data: sortedness
+ * of contiguous windows and of evenly spaced sample, duplicates ratio & keys range of sample
+ * @param threads_count threads budget, 0 means online processors count
+ * @return sort_t enum*/
+int
+sort_engine_autotune( const BigArrayPtr array, int array_len, int threads_count ){
+	if ( array_len < AUTOTUNE_SMALL_ARRAY_LEN )
+		return ESORT_BOTTOM_UP_MERGE;
+
+	/*local order of items in contiguous windows spread over array*/
+	int ascending_pairs = 0, descending_pairs = 0, pairs = 0;
+	for ( int w=0; w < AUTOTUNE_WINDOWS_COUNT; w++ ){
+		const BigArrayItem *window = array +
+				(long long)(array_len - AUTOTUNE_WINDOW_LEN) * w / (AUTOTUNE_WINDOWS_COUNT-1);
+		for ( int i=1; i < AUTOTUNE_WINDOW_LEN; i++ ){
+			ascending_pairs += item_less_equal( window[i-1], window[i] );
+			descending_pairs += item_less_equal( window[i], window[i-1] );
+			++pairs;
+		}
+	}
+	/*global order of evenly spaced sample*/
+	BigArrayItem sample[AUTOTUNE_SAMPLE_LEN];
+	int sample_ascending_pairs = 0, sample_descending_pairs = 0;
+	for ( int i=0; i < AUTOTUNE_SAMPLE_LEN; i++ ){
+		sample[i] = array[ (long long)array_len * i / AUTOTUNE_SAMPLE_LEN ];
+		if ( i > 0 ){
+			sample_ascending_pairs += item_less_equal( sample[i-1], sample[i] );
+			sample_descending_pairs += item_less_equal( sample[i], sample[i-1] );
+		}
+	}
+	const int presorted_pairs = pairs * AUTOTUNE_PRESORTED_PERCENT / 100;
+	const int presorted_sample_pairs = (AUTOTUNE_SAMPLE_LEN-1) * AUTOTUNE_PRESORTED_PERCENT / 100;
+	if ( (ascending_pairs >= presorted_pairs && sample_ascending_pairs >= presorted_sample_pairs) ||
+		 (descending_pairs >= presorted_pairs && sample_descending_pairs >= presorted_sample_pairs) )
+		return ESORT_ADAPTIVE;
+
+	if ( threads_count <= 0 )
+		threads_count = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	if ( threads_count > 1 && array_len >= AUTOTUNE_PARALLEL_ARRAY_LEN )
+		return ESORT_PARALLEL;
+
+	/*duplicates & keys range of sorted sample*/
+	BigArrayItem sorted_sample[AUTOTUNE_SAMPLE_LEN];
+	bottom_up_merge_sort( sample, sorted_sample, AUTOTUNE_SAMPLE_LEN );
+	int duplicates = 0;
+	for ( int i=1; i < AUTOTUNE_SAMPLE_LEN; i++ )
+		duplicates += item_key( sorted_sample[i-1] ) == item_key( sorted_sample[i] );
+	SortKey keys_range = item_key( sorted_sample[AUTOTUNE_SAMPLE_LEN-1] ) - item_key( sorted_sample[0] );
+	int key_bits = 0;
+	while( key_bits < (int)sizeof(SortKey)*8 && (keys_range >> key_bits) )
+		++key_bits;
+	/*radix skips passes of equal digits, comparison sort suffers from duplicates*/
+	if ( key_bits <= AUTOTUNE_RADIX_KEY_BITS ||
+		 duplicates >= AUTOTUNE_SAMPLE_LEN * AUTOTUNE_DUPLICATES_PERCENT / 100 )
+		return ESORT_RADIX;
+
+	/*vectorized merge sort is the fastest on random keys, radix is if no SIMD kernels*/
+	return sort_kernels()->merge != merge_into_scalar ? ESORT_BOTTOM_UP_MERGE : ESORT_RADIX;
+}
+
+
+/**Sort array by engine selected in params, ESORT_AUTO engine is selected by autotuner.
+ * Used engine & engine statistics are saved into params
+ * @return sorted copy of array, caller is responsive to free it*/
+BigArrayPtr
+alloc_sort( struct sort_params_t *params, const BigArrayPtr array, int array_len ){
+	params->used_engine = params->engine;
+	if ( ESORT_AUTO == params->engine )
+		params->used_engine = sort_engine_autotune( array, array_len, params->threads_count );
+	const struct sort_engine_t *engine = sort_engine( params->used_engine );
+	if ( !engine ){
+		params->used_engine = ESORT_BOTTOM_UP_MERGE;
+		engine = sort_engine( params->used_engine );
+	}
+	BigArrayPtr sorted_array = malloc( sizeof(BigArrayItem)*array_len );
+	engine->sort( array, sorted_array, array_len, params );
+	return sorted_array;
 }
 
 
 void copy_array( BigArrayPtr dst_array, const BigArrayPtr src_array, int array_len ){
-	for ( int i=0; i < array_len; i++ )
-		dst_array[i] = src_array[i];
+	memcpy( dst_array, src_array, sizeof(BigArrayItem)*array_len );
 }
 
 
@@ -135,8 +555,8 @@ void print_array(const char* text, BigArrayPtr array, int len){
 	puts(text);
 	if ( len > 100 ) len = 100;
 	for (int j=0; j<len; j++){
-		if ( !j ) printf( "%d", array[j] );
-		else printf( ",%d", array[j] );
+		if ( !j ) printf( "%llu", (unsigned long long)item_key( array[j] ) );
+		else printf( ",%llu", (unsigned long long)item_key( array[j] ) );
 	}
 	fflush(0);
 }
@@ -145,12 +565,12 @@ uint32_t array_crc( BigArrayPtr array, int len ){
 	uint32_t crc = 0;
 	int initial;
 	if ( len >=1 ){
-		crc = (crc+array[0]) % 1000000;
+		crc = (crc+(uint32_t)(item_key(array[0]) % 1000000)) % 1000000;
 	}
 	else return 1; //empty array always sorted
 	for ( int i=1; i < len; i++ )
 	{
-		crc = (crc+array[i]) % 1000000;
+		crc = (crc+(uint32_t)(item_key(array[i]) % 1000000)) % 1000000;
 	}
 	return crc;
 }
@@ -158,18 +578,18 @@ uint32_t array_crc( BigArrayPtr array, int len ){
 int test_sort_result( const BigArrayPtr unsorted, const BigArrayPtr sorted, int len ){
 	uint32_t unsorted_crc = 0;
 	uint32_t sorted_crc = 0;
-	int initial;
+	BigArrayItem initial;
 	if ( len >=1 ){
 		initial = sorted[0];
-		unsorted_crc = (unsorted_crc+unsorted[0]) % 1000000;
-		sorted_crc = (sorted_crc+sorted[0]) % 1000000;
+		unsorted_crc = (unsorted_crc+(uint32_t)(item_key(unsorted[0]) % 1000000)) % 1000000;
+		sorted_crc = (sorted_crc+(uint32_t)(item_key(sorted[0]) % 1000000)) % 1000000;
 	}
 	else return 1;
 	for ( int i=1; i < len; i++ ){
-		unsorted_crc = (unsorted_crc+unsorted[i]) % 1000000;
-		sorted_crc = (sorted_crc+sorted[i]) % 1000000;
+		unsorted_crc = (unsorted_crc+(uint32_t)(item_key(unsorted[i]) % 1000000)) % 1000000;
+		sorted_crc = (sorted_crc+(uint32_t)(item_key(sorted[i]) % 1000000)) % 1000000;
 
-		if ( initial > sorted[i] ) return 0;
+		if ( item_less( sorted[i], initial ) ) return 0;
 		else initial = sorted[i];
 	}
 
@@ -180,10 +600,10 @@ int test_sort_result( const BigArrayPtr unsorted, const BigArrayPtr sorted, int
 	return 1;
 }
 
-int run_sort( BigArrayPtr *unsorted, BigArrayPtr *sorted, int sortlen )
+int run_sort( struct sort_params_t *params, BigArrayPtr *unsorted, BigArrayPtr *sorted, int sortlen )
 {
 	*unsorted = alloc_array_fill_random( sortlen );
-	*sorted = alloc_merge_sort( *unsorted, sortlen );
+	*sorted = alloc_sort( params, *unsorted, sortlen );
 
 	if ( test_sort_result( *unsorted, *sorted, sortlen ) )
 		return 1;
@@ -192,6 +612,15 @@ int run_sort( BigArrayPtr *unsorted, BigArrayPtr *sorted, int sortlen )
 	return 0;
 }
 
+/*the same as run_sort, but permutation of sorted items is kept, it's used by argsort mode*/
+int run_argsort( BigArrayPtr *unsorted, BigArrayPtr *sorted, uint32_t *permutation, int sortlen )
+{
+	*unsorted = alloc_array_fill_random( sortlen );
+	*sorted = malloc( sizeof(BigArrayItem)*sortlen );
+	radix_argsort( *unsorted, *sorted, permutation, sortlen );
+	return test_sort_result( *unsorted, *sorted, sortlen );
+}
+
 
 
 
@@ -8,20 +8,66 @@
 #ifndef SORT_H_
 #define SORT_H_
 
+#include "sort_item.h" //BigArrayItem, SortKey
 #include <stdint.h> //uint32_t
 #include <stddef.h> //size_t
 
 
-typedef uint32_t* BigArrayPtr;
-typedef uint32_t  BigArrayItem;
+typedef BigArrayItem* BigArrayPtr;
 typedef struct histogram_item_t *HistogramArrayPtr;
 typedef struct histogram_item_t HistogramArrayItem;
 
+/*Local sorting engines, ESORT_AUTO - engine is selected by autotuner for every sorting array*/
+enum sort_t { ESORT_AUTO=-1, ESORT_RECURSIVE_MERGE, ESORT_BOTTOM_UP_MERGE, ESORT_RADIX, ESORT_PARALLEL,
+	ESORT_CACHE_BLOCKED, ESORT_ADAPTIVE, ESORT_COUNT };
+
+/*Local sorting settings used by alloc_sort*/
+struct sort_params_t{
+	int engine; //sort_t enum
+	int threads_count; //used by ESORT_PARALLEL, 0 means online processors count
+	int used_engine; //engine actually used by last sorting, it's selected by autotuner for ESORT_AUTO
+	int runs_count; //statistics of ESORT_ADAPTIVE: runs count found in sorting data
+};
+
+/*Sorting engine interface, sorted_array is caller provided output*/
+struct sort_engine_t{
+	const char *name;
+	void (*sort)( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+			struct sort_params_t *params );
+};
+
+/*Sorting kernels, the best of it is selected at runtime by CPU features*/
+struct sort_kernels_t{
+	const char *name;
+	int block_len; //items count sorted by sort_block
+	void (*sort_block)( BigArrayPtr block );
+	void (*merge)( BigArrayPtr dst_array, const BigArrayPtr left_array, int left_array_len,
+			const BigArrayPtr right_array, int right_array_len );
+};
+
+/*Tournament tree of losers over heads of sorted runs used by k-way merge*/
+struct loser_tree_t{
+	int runs_count;
+	int leaves_count; //power of 2 not less than runs_count
+	const BigArrayItem **heads; //current head item of every run
+	const BigArrayItem **ends;
+	int *losers; //losers[0] is winner run index, losers[1..leaves_count) are inner nodes
+};
+
 struct histogram_item_t
 {
 	int item_index;
 	int last_item_index;
-	BigArrayItem item;
+	SortKey item; //key of sampled array item
+};
+
+/*Header of compact histogram sent between nodes, items indexes aren't sent: it's offset+i*step.
+ *Header is followed by varint encoded deltas of items keys*/
+struct histogram_header_t
+{
+	int offset;
+	int step;
+	int count;
 };
 
 
@@ -30,15 +76,54 @@ void print_histogram( const HistogramArrayPtr histogram, size_t len );
 HistogramArrayPtr
 alloc_histogram_array_get_len(
 		const BigArrayPtr array, int offset, const int array_len, int step, int *histogram_len );
-int run_sort( BigArrayPtr *unsorted, BigArrayPtr *sorted, int sortlen );
+uint8_t* alloc_histogram_encode_get_size( const HistogramArrayPtr histogram, int histogram_len, size_t *size );
+HistogramArrayPtr alloc_histogram_decode_get_len( const uint8_t *encoded, size_t size, int *histogram_len );
+int run_sort( struct sort_params_t *params, BigArrayPtr *unsorted, BigArrayPtr *sorted, int sortlen );
+int run_argsort( BigArrayPtr *unsorted, BigArrayPtr *sorted, uint32_t *permutation, int sortlen );
 BigArrayPtr alloc_array_fill_random( int array_len );
+BigArrayPtr alloc_array_fill_random_seed( int array_len, unsigned seed );
+BigArrayPtr alloc_sort( struct sort_params_t *params, const BigArrayPtr array, int array_len );
+const struct sort_engine_t* sort_engine( int engine );
+int sort_engine_autotune( const BigArrayPtr array, int array_len, int threads_count );
 BigArrayPtr alloc_merge_sort( BigArrayPtr array, int array_len );
+void adaptive_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len, int *runs_count );
+void cache_blocked_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len );
+void multiway_merge( BigArrayPtr dst_array, const BigArrayPtr *runs, const int *runs_len, int runs_count );
+int array_lower_bound( const BigArrayItem *run, int run_len, SortKey key );
+int array_upper_bound( const BigArrayItem *run, int run_len, SortKey key );
+void multiway_merge_split( const BigArrayPtr *runs, const int *runs_len, int runs_count, int rank, int *splits );
+void parallel_multiway_merge( BigArrayPtr dst_array, const BigArrayPtr *runs, const int *runs_len, int runs_count,
+		int threads_count );
+void loser_tree_init( struct loser_tree_t *tree, const BigArrayPtr *runs, const int *runs_len, int runs_count );
+void loser_tree_replay( struct loser_tree_t *tree );
+int loser_tree_winner( const struct loser_tree_t *tree );
+void loser_tree_free( struct loser_tree_t *tree );
+void bottom_up_merge_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len );
+void bottom_up_merge_sort_scratch( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len,
+		BigArrayPtr scratch );
+void radix_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len );
+void radix_argsort( const BigArrayPtr array, BigArrayPtr sorted_array, uint32_t *permutation, int array_len );
+void parallel_sort( const BigArrayPtr array, BigArrayPtr sorted_array, int array_len, int threads_count );
+int merge_path_split( const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len, int diagonal );
 BigArrayPtr merge( BigArrayPtr left_array, int left_array_len,
 		BigArrayPtr right_array, int right_array_len );
+void merge_into( BigArrayPtr dst_array, const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len );
+void merge_into_scalar( BigArrayPtr dst_array, const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len );
+void insertion_sort( BigArrayPtr array, int array_len );
+const struct sort_kernels_t* sort_kernels();
+void copy_array( BigArrayPtr dst_array, const BigArrayPtr src_array, int array_len );
 void print_array(const char* text, BigArrayPtr array, int len);
 int test_sort_result( BigArrayPtr unsorted, BigArrayPtr sorted, int len );
 uint32_t array_crc( BigArrayPtr array, int len );
 
+static inline int
+min_len( int a, int b ){
+	return a < b ? a : b;
+}
+
 
 
 #endif /* SORT_H_ */
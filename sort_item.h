@@ -0,0 +1,117 @@
+/*
+ * sort_item.h
+ *
+ *      Type of sorting items selected at build time by BIG_ARRAY_ITEM_TYPE, e.g.
+ *      make ITEM_TYPE=ITEM_DOUBLE. Every type is compiled into own specialized binary,
+ *      so sort, histogram, splitter & exchange code has no comparator callbacks in hot loops.
+ *      Items are compared & radix sorted by SortKey - unsigned order-preserving key of item,
+ *      histograms & splitters are carrying keys only, exchange is moving whole items.
+ */
+
+#ifndef SORT_ITEM_H_
+#define SORT_ITEM_H_
+
+#include <stdint.h> //uint32_t
+#include <string.h> //memcpy
+#include <stdio.h> //snprintf
+
+#define ITEM_UINT32 0
+#define ITEM_UINT64 1
+#define ITEM_INT32  2
+#define ITEM_INT64  3
+#define ITEM_FLOAT  4
+#define ITEM_DOUBLE 5
+#define ITEM_RECORD 6 /*fixed size record: 64-bit key prefix & payload*/
+
+#ifndef BIG_ARRAY_ITEM_TYPE
+#define BIG_ARRAY_ITEM_TYPE ITEM_UINT32
+#endif
+
+/*Payload bytes of ITEM_RECORD, records of 16..100 bytes are 8..92*/
+#ifndef RECORD_PAYLOAD_SIZE
+#define RECORD_PAYLOAD_SIZE 24
+#endif
+
+
+#if BIG_ARRAY_ITEM_TYPE == ITEM_UINT32
+typedef uint32_t BigArrayItem;
+typedef uint32_t SortKey;
+static inline SortKey item_key( BigArrayItem item ){ return item; }
+
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_UINT64
+typedef uint64_t BigArrayItem;
+typedef uint64_t SortKey;
+static inline SortKey item_key( BigArrayItem item ){ return item; }
+
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_INT32
+typedef int32_t BigArrayItem;
+typedef uint32_t SortKey;
+/*flip sign bit: negative numbers go below positive*/
+static inline SortKey item_key( BigArrayItem item ){ return (uint32_t)item ^ 0x80000000u; }
+
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_INT64
+typedef int64_t BigArrayItem;
+typedef uint64_t SortKey;
+static inline SortKey item_key( BigArrayItem item ){ return (uint64_t)item ^ 0x8000000000000000ull; }
+
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_FLOAT
+typedef float BigArrayItem;
+typedef uint32_t SortKey;
+/*IEEE 754: negative numbers have all bits inverted, positive numbers sign bit set, NaN unsupported*/
+static inline SortKey item_key( BigArrayItem item ){
+	uint32_t bits;
+	memcpy( &bits, &item, sizeof(bits) );
+	return bits ^ (-(bits >> 31) | 0x80000000u);
+}
+
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_DOUBLE
+typedef double BigArrayItem;
+typedef uint64_t SortKey;
+static inline SortKey item_key( BigArrayItem item ){
+	uint64_t bits;
+	memcpy( &bits, &item, sizeof(bits) );
+	return bits ^ (-(bits >> 63) | 0x8000000000000000ull);
+}
+
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_RECORD
+struct record_t{
+	uint64_t key;
+	uint8_t payload[RECORD_PAYLOAD_SIZE];
+};
+typedef struct record_t BigArrayItem;
+typedef uint64_t SortKey;
+static inline SortKey item_key( BigArrayItem item ){ return item.key; }
+
+#else
+#error "unknown BIG_ARRAY_ITEM_TYPE"
+#endif
+
+
+static inline int
+item_less( BigArrayItem a, BigArrayItem b ){
+	return item_key( a ) < item_key( b );
+}
+
+static inline int
+item_less_equal( BigArrayItem a, BigArrayItem b ){
+	return item_key( a ) <= item_key( b );
+}
+
+/*Text of item value for logs, record is printed by key & head of payload*/
+static inline const char*
+item_format( BigArrayItem item, char *buf, size_t size ){
+#if BIG_ARRAY_ITEM_TYPE == ITEM_UINT32 || BIG_ARRAY_ITEM_TYPE == ITEM_UINT64
+	snprintf( buf, size, "%llu", (unsigned long long)item );
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_INT32 || BIG_ARRAY_ITEM_TYPE == ITEM_INT64
+	snprintf( buf, size, "%lld", (long long)item );
+#elif BIG_ARRAY_ITEM_TYPE == ITEM_FLOAT || BIG_ARRAY_ITEM_TYPE == ITEM_DOUBLE
+	snprintf( buf, size, "%.17g", (double)item );
+#else
+	snprintf( buf, size, "{key=%llu, payload=%02x%02x%02x%02x..}", (unsigned long long)item.key,
+			item.payload[0], item.payload[1], item.payload[2], item.payload[3] );
+#endif
+	return buf;
+}
+
+
+#endif /* SORT_ITEM_H_ */
\ No newline at end of file
@@ -0,0 +1,238 @@
+/*
+ * sort_simd.c
+ *
+ *      Sorting kernels for 32-bit items: in-register bitonic sorting network for small blocks
+ *      and vectorized bitonic merge of two sorted runs. SSE4.1 & AVX2 versions are compiled
+ *      with target attributes and choosen at runtime by CPUID, scalar kernels are fallback.
+ */
+
+#include "sort.h"
+#include <string.h>
+#include <pthread.h>
+
+/*vectorized kernels are for 32-bit unsigned items only, other types use scalar kernels*/
+#if (defined(__x86_64__) || defined(__i386__)) && BIG_ARRAY_ITEM_TYPE == ITEM_UINT32
+#define SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+/*Items count sorted by sort_block of every kernel*/
+#define KERNEL_BLOCK_LEN 16
+
+
+static void
+sort_block_scalar( BigArrayPtr block ){
+	insertion_sort( block, KERNEL_BLOCK_LEN );
+}
+
+static const struct sort_kernels_t s_scalar_kernels = {
+		"scalar", KERNEL_BLOCK_LEN, sort_block_scalar, merge_into_scalar };
+
+
+#ifdef SIMD_KERNELS
+
+/*Merge the rest of vectorized merge: kept register items, short rest of run choosen to load next
+ *& rest of other run, short arrays are merged on stack first*/
+static void
+merge_rest( BigArrayPtr dst, const BigArrayPtr kept, int kept_len,
+		const BigArrayPtr short_run, int short_run_len, const BigArrayPtr other_run, int other_run_len ){
+	BigArrayItem merged[KERNEL_BLOCK_LEN];
+	merge_into_scalar( merged, kept, kept_len, short_run, short_run_len );
+	merge_into_scalar( dst, merged, kept_len+short_run_len, other_run, other_run_len );
+}
+
+
+/*SSE4.1, 4 items per register*/
+
+/*compare-exchange lanes with partners selected by shuffle, blend mask marks lanes taking max*/
+#define CMPXCHG_SSE( v, shuffle, mask ) \
+	do{ __m128i _p = _mm_shuffle_epi32( v, shuffle ); \
+		v = _mm_blend_epi16( _mm_min_epu32( v, _p ), _mm_max_epu32( v, _p ), mask ); }while(0)
+
+static inline __attribute__((target("sse4.1"))) __m128i
+bitonic_sort_4( __m128i v ){
+	CMPXCHG_SSE( v, _MM_SHUFFLE(2,3,0,1), 0x3C );
+	CMPXCHG_SSE( v, _MM_SHUFFLE(1,0,3,2), 0xF0 );
+	CMPXCHG_SSE( v, _MM_SHUFFLE(2,3,0,1), 0xCC );
+	return v;
+}
+
+/*a & b are sorted, on return a holds 4 least items, b - 4 largest*/
+static inline __attribute__((target("sse4.1"))) void
+bitonic_merge_4x4( __m128i *a, __m128i *b ){
+	__m128i reversed = _mm_shuffle_epi32( *b, _MM_SHUFFLE(0,1,2,3) );
+	__m128i low = _mm_min_epu32( *a, reversed );
+	__m128i high = _mm_max_epu32( *a, reversed );
+	CMPXCHG_SSE( low, _MM_SHUFFLE(1,0,3,2), 0xF0 );
+	CMPXCHG_SSE( low, _MM_SHUFFLE(2,3,0,1), 0xCC );
+	CMPXCHG_SSE( high, _MM_SHUFFLE(1,0,3,2), 0xF0 );
+	CMPXCHG_SSE( high, _MM_SHUFFLE(2,3,0,1), 0xCC );
+	*a = low;
+	*b = high;
+}
+
+static __attribute__((target("sse4.1"))) void
+merge_sse41( BigArrayPtr dst, const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len ){
+	if ( left_array_len < 4 || right_array_len < 4 ){
+		merge_into_scalar( dst, left_array, left_array_len, right_array, right_array_len );
+		return;
+	}
+	__m128i low = _mm_loadu_si128( (const __m128i*)left_array );
+	__m128i high = _mm_loadu_si128( (const __m128i*)right_array );
+	int li = 4, ri = 4;
+	for(;;){
+		bitonic_merge_4x4( &low, &high );
+		_mm_storeu_si128( (__m128i*)dst, low );
+		dst += 4;
+		/*next items are loaded from run with least head item, while it has full register*/
+		int take_left = li < left_array_len &&
+				( ri >= right_array_len || left_array[li] <= right_array[ri] );
+		if ( take_left && li+4 <= left_array_len ){
+			low = _mm_loadu_si128( (const __m128i*)(left_array+li) );
+			li += 4;
+		}
+		else if ( !take_left && ri+4 <= right_array_len ){
+			low = _mm_loadu_si128( (const __m128i*)(right_array+ri) );
+			ri += 4;
+		}
+		else break;
+	}
+	BigArrayItem kept[4];
+	_mm_storeu_si128( (__m128i*)kept, high );
+	if ( li+4 > left_array_len )
+		merge_rest( dst, kept, 4, left_array+li, left_array_len-li, right_array+ri, right_array_len-ri );
+	else
+		merge_rest( dst, kept, 4, right_array+ri, right_array_len-ri, left_array+li, left_array_len-li );
+}
+
+static __attribute__((target("sse4.1"))) void
+sort_block_sse41( BigArrayPtr block ){
+	__m128i v0 = bitonic_sort_4( _mm_loadu_si128( (const __m128i*)block ) );
+	__m128i v1 = bitonic_sort_4( _mm_loadu_si128( (const __m128i*)(block+4) ) );
+	__m128i v2 = bitonic_sort_4( _mm_loadu_si128( (const __m128i*)(block+8) ) );
+	__m128i v3 = bitonic_sort_4( _mm_loadu_si128( (const __m128i*)(block+12) ) );
+	bitonic_merge_4x4( &v0, &v1 );
+	bitonic_merge_4x4( &v2, &v3 );
+	BigArrayItem runs[KERNEL_BLOCK_LEN];
+	_mm_storeu_si128( (__m128i*)runs, v0 );
+	_mm_storeu_si128( (__m128i*)(runs+4), v1 );
+	_mm_storeu_si128( (__m128i*)(runs+8), v2 );
+	_mm_storeu_si128( (__m128i*)(runs+12), v3 );
+	merge_sse41( block, runs, 8, runs+8, 8 );
+}
+
+static const struct sort_kernels_t s_sse41_kernels = {
+		"sse4.1", KERNEL_BLOCK_LEN, sort_block_sse41, merge_sse41 };
+
+
+/*AVX2, 8 items per register*/
+
+#define CMPXCHG_AVX2( v, permutation, mask ) \
+	do{ __m256i _p = _mm256_permutevar8x32_epi32( v, permutation ); \
+		v = _mm256_blend_epi32( _mm256_min_epu32( v, _p ), _mm256_max_epu32( v, _p ), mask ); }while(0)
+
+/*lanes permutations to partner lane i^1, i^2, i^4 & reverse*/
+#define PARTNER_1_AVX2 _mm256_setr_epi32( 1, 0, 3, 2, 5, 4, 7, 6 )
+#define PARTNER_2_AVX2 _mm256_setr_epi32( 2, 3, 0, 1, 6, 7, 4, 5 )
+#define PARTNER_4_AVX2 _mm256_setr_epi32( 4, 5, 6, 7, 0, 1, 2, 3 )
+#define REVERSE_AVX2   _mm256_setr_epi32( 7, 6, 5, 4, 3, 2, 1, 0 )
+
+static inline __attribute__((target("avx2"))) __m256i
+bitonic_sort_8( __m256i v ){
+	CMPXCHG_AVX2( v, PARTNER_1_AVX2, 0x66 );
+	CMPXCHG_AVX2( v, PARTNER_2_AVX2, 0x3C );
+	CMPXCHG_AVX2( v, PARTNER_1_AVX2, 0x5A );
+	CMPXCHG_AVX2( v, PARTNER_4_AVX2, 0xF0 );
+	CMPXCHG_AVX2( v, PARTNER_2_AVX2, 0xCC );
+	CMPXCHG_AVX2( v, PARTNER_1_AVX2, 0xAA );
+	return v;
+}
+
+/*a & b are sorted, on return a holds 8 least items, b - 8 largest*/
+static inline __attribute__((target("avx2"))) void
+bitonic_merge_8x8( __m256i *a, __m256i *b ){
+	__m256i reversed = _mm256_permutevar8x32_epi32( *b, REVERSE_AVX2 );
+	__m256i low = _mm256_min_epu32( *a, reversed );
+	__m256i high = _mm256_max_epu32( *a, reversed );
+	CMPXCHG_AVX2( low, PARTNER_4_AVX2, 0xF0 );
+	CMPXCHG_AVX2( low, PARTNER_2_AVX2, 0xCC );
+	CMPXCHG_AVX2( low, PARTNER_1_AVX2, 0xAA );
+	CMPXCHG_AVX2( high, PARTNER_4_AVX2, 0xF0 );
+	CMPXCHG_AVX2( high, PARTNER_2_AVX2, 0xCC );
+	CMPXCHG_AVX2( high, PARTNER_1_AVX2, 0xAA );
+	*a = low;
+	*b = high;
+}
+
+static __attribute__((target("avx2"))) void
+merge_avx2( BigArrayPtr dst, const BigArrayPtr left_array, int left_array_len,
+		const BigArrayPtr right_array, int right_array_len ){
+	if ( left_array_len < 8 || right_array_len < 8 ){
+		merge_into_scalar( dst, left_array, left_array_len, right_array, right_array_len );
+		return;
+	}
+	__m256i low = _mm256_loadu_si256( (const __m256i*)left_array );
+	__m256i high = _mm256_loadu_si256( (const __m256i*)right_array );
+	int li = 8, ri = 8;
+	for(;;){
+		bitonic_merge_8x8( &low, &high );
+		_mm256_storeu_si256( (__m256i*)dst, low );
+		dst += 8;
+		int take_left = li < left_array_len &&
+				( ri >= right_array_len || left_array[li] <= right_array[ri] );
+		if ( take_left && li+8 <= left_array_len ){
+			low = _mm256_loadu_si256( (const __m256i*)(left_array+li) );
+			li += 8;
+		}
+		else if ( !take_left && ri+8 <= right_array_len ){
+			low = _mm256_loadu_si256( (const __m256i*)(right_array+ri) );
+			ri += 8;
+		}
+		else break;
+	}
+	BigArrayItem kept[8];
+	_mm256_storeu_si256( (__m256i*)kept, high );
+	if ( li+8 > left_array_len )
+		merge_rest( dst, kept, 8, left_array+li, left_array_len-li, right_array+ri, right_array_len-ri );
+	else
+		merge_rest( dst, kept, 8, right_array+ri, right_array_len-ri, left_array+li, left_array_len-li );
+}
+
+static __attribute__((target("avx2"))) void
+sort_block_avx2( BigArrayPtr block ){
+	__m256i v0 = bitonic_sort_8( _mm256_loadu_si256( (const __m256i*)block ) );
+	__m256i v1 = bitonic_sort_8( _mm256_loadu_si256( (const __m256i*)(block+8) ) );
+	bitonic_merge_8x8( &v0, &v1 );
+	_mm256_storeu_si256( (__m256i*)block, v0 );
+	_mm256_storeu_si256( (__m256i*)(block+8), v1 );
+}
+
+static const struct sort_kernels_t s_avx2_kernels = {
+		"avx2", KERNEL_BLOCK_LEN, sort_block_avx2, merge_avx2 };
+
+#endif //SIMD_KERNELS
+
+
+static const struct sort_kernels_t *s_kernels = &s_scalar_kernels;
+static pthread_once_t s_kernels_once = PTHREAD_ONCE_INIT;
+
+static void
+select_kernels(){
+#ifdef SIMD_KERNELS
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports("avx2") )
+		s_kernels = &s_avx2_kernels;
+	else if ( __builtin_cpu_supports("sse4.1") )
+		s_kernels = &s_sse41_kernels;
+#endif
+}
+
+/**Kernels are selected once by CPUID features, scalar kernels if no SIMD support,
+ * selection is synchronized as merge_into calls it from worker threads
+ * @return the best kernels available on running CPU*/
+const struct sort_kernels_t*
+sort_kernels(){
+	pthread_once( &s_kernels_once, select_kernels );
+	return s_kernels;
+}
@@ -0,0 +1,1169 @@
+/*
+ * splitter.c
+ *
+ *      Splitters search of manager, see splitter.h
+ */
+
+#include "splitter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h> //getpid
+#include <assert.h>
+#include <sys/time.h> //gettimeofday
+
+//#define DEBUG
+
+static int detailed_histogram_start_index( const struct histogram_worker* worker );
+void get_begin_end_histograms_item_indexes( const struct histogram_worker* worker, int *first_item_index, int *end_item_index );
+
+
+/*@return item index of detailed histogram item, index after last item is next item after it*/
+static int
+detailed_histogram_item_index( const struct histogram_worker* worker, int index ){
+	const struct Histogram *histogram = &worker->detailed_histogram;
+	if ( index < histogram->array_len )
+		return histogram->array[ index ].item_index;
+	return histogram->array[ histogram->array_len-1 ].item_index + 1;
+}
+
+
+void
+init_worker( struct histogram_worker* worker ){
+	worker->detailed_histogram.array = NULL;
+	worker->helper.begin_histogram_index = 0;
+	worker->helper.end_histogram_index = 0;
+	worker->helper.begin_detailed_histogram_index = 0;
+	worker->helper.end_detailed_histogram_index = 0;
+	worker->helper.begin_offset = 0;
+	worker->current_histogram_complete = 0;
+}
+
+
+/*@return index of first big histogram item not less than item index, starting from cursor*/
+static int
+big_histogram_lower_bound( const struct histogram_worker* worker, int item_index ){
+	/*item indexes of big histogram are ascending*/
+	int first = worker->helper.end_histogram_index;
+	int last = worker->histogram.array_len;
+	while( first < last ){
+		int middle = first + (last-first)/2;
+		if ( worker->histogram.array[middle].item_index < item_index )
+			first = middle+1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+
+/*@return 1 if worker is switched from detailed histogram back to big histogram*/
+int
+check_remove_detailed_histogram( struct histogram_worker* worker ){
+	if ( worker->detailed_histogram.array ){
+		/*cursor of passed detailed histogram is at item next to its last item*/
+		int current_item_index = detailed_histogram_item_index( worker,
+				worker->helper.end_detailed_histogram_index + worker->current_histogram_complete );
+		int first = big_histogram_lower_bound( worker, current_item_index );
+		int index = first < worker->histogram.array_len ? first : 0;
+		/*if current item of detailed_histogram is last item from detailed_histogram can be synchronized
+				e.g. equal to one of big histogram items then synchronize it;*/
+		if ( worker->histogram.array[index].item_index == current_item_index ){
+			worker->current_histogram_complete = 0;
+			worker->helper.begin_offset = detailed_histogram_item_index( worker, worker->helper.begin_detailed_histogram_index );
+			worker->helper.begin_histogram_index = worker->helper.end_histogram_index = index;
+			/*detailed histogram currently no needed, discard detailed histogram*/
+			free( worker->detailed_histogram.array );
+			worker->detailed_histogram.array = NULL;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+void
+init_histogram( struct histogram_worker* worker ){
+	worker->helper.begin_offset = 0;
+	if ( worker->detailed_histogram.array ){
+		worker->helper.begin_histogram_index = -1; //uninitialized can't be used
+		/*passed detailed histogram: range begins after its last item*/
+		worker->helper.begin_detailed_histogram_index =
+				worker->helper.end_detailed_histogram_index + worker->current_histogram_complete;
+	}else{
+		worker->helper.begin_histogram_index = worker->helper.end_histogram_index;
+	}
+}
+
+void
+set_detailed_histogram( struct histogram_worker* worker, struct Histogram* detailed_histogram  ){
+	if ( !detailed_histogram->array_len ){
+		/*source has no items left*/
+		free( detailed_histogram->array );
+		return;
+	}
+	if ( worker->detailed_histogram.array ){
+		/*worker isn't synchronized with big histogram yet, its detailed histogram is renewed from
+		 *begin of current range & cursor stays at the same item*/
+		int cursor_index = worker->detailed_histogram.array[worker->helper.end_detailed_histogram_index].item_index
+				+ worker->current_histogram_complete - detailed_histogram->array[0].item_index;
+		free( worker->detailed_histogram.array );
+		worker->detailed_histogram = *detailed_histogram;
+		worker->helper.begin_detailed_histogram_index = 0;
+		worker->current_histogram_complete = cursor_index >= detailed_histogram->array_len;
+		worker->helper.end_detailed_histogram_index = min( cursor_index, (int)detailed_histogram->array_len-1 );
+		return;
+	}
+	/*test: 0 item index of 'detailed histogram' should be equal to requested start*/
+	assert( detailed_histogram->array[0].item_index == detailed_histogram_start_index( worker ) );
+	worker->detailed_histogram = *detailed_histogram;
+	/*pointing to begin of detailed histogram*/
+	worker->helper.begin_detailed_histogram_index = worker->helper.end_detailed_histogram_index=0;
+}
+
+void
+set_next_histogram( struct histogram_worker* worker ){
+	if ( worker->detailed_histogram.array ){
+		const int next_item_index = detailed_histogram_item_index( worker, worker->detailed_histogram.array_len );
+		if ( worker->helper.end_detailed_histogram_index+1 == worker->detailed_histogram.array_len &&
+			 next_item_index < worker->items_count ){
+			/*detailed histogram is passed before end of source, e.g. by run of equal keys, so worker goes on
+			 *by big histogram from next item, range begin is kept*/
+			int first_item_index, end_item_index;
+			get_begin_end_histograms_item_indexes( worker, &first_item_index, &end_item_index );
+			worker->helper.end_histogram_index = big_histogram_lower_bound( worker, next_item_index );
+			worker->helper.begin_histogram_index = first_item_index ? worker->helper.end_histogram_index : 0;
+			worker->helper.begin_offset = first_item_index;
+			free( worker->detailed_histogram.array );
+			worker->detailed_histogram.array = NULL;
+			return;
+		}
+		if ( worker->helper.end_detailed_histogram_index+1 == worker->detailed_histogram.array_len )
+			worker->current_histogram_complete = 1; //flag
+		if ( ! worker->current_histogram_complete )
+			worker->helper.end_detailed_histogram_index++;
+	}
+	else
+		worker->helper.end_histogram_index++;
+}
+
+
+HistogramArrayPtr
+value_at_cursor_histogram( struct histogram_worker* worker ){
+	struct Histogram *histogram = &worker->histogram;
+	int *end_histogram_index = &worker->helper.end_histogram_index;
+	if ( worker->detailed_histogram.array ){
+		histogram = &worker->detailed_histogram;
+		end_histogram_index = &worker->helper.end_detailed_histogram_index;
+	}
+
+	if ( !worker->current_histogram_complete && *end_histogram_index < histogram->array_len){
+		return &histogram->array[ *end_histogram_index ];
+	}
+	return 0;
+}
+
+
+int
+length_current_histogram( const struct histogram_worker* worker ){
+	const struct Histogram* histogram = &worker->histogram;
+	int end_histogram_index = worker->helper.end_histogram_index;
+	if ( worker->detailed_histogram.array ){
+		histogram = &worker->detailed_histogram;
+		end_histogram_index = worker->helper.end_detailed_histogram_index;
+	}
+	/*cursor passed big histogram has length of its last item*/
+	end_histogram_index = min( end_histogram_index, (int)histogram->array_len-1 );
+	return histogram->array[ end_histogram_index ].last_item_index - histogram->array[ end_histogram_index ].item_index + 1;
+}
+
+
+/*@return item index of big histogram item, cursor passed last item is at end of source*/
+static int
+big_histogram_item_index( const struct histogram_worker* worker, int index ){
+	if ( index < worker->histogram.array_len )
+		return worker->histogram.array[ index ].item_index;
+	return worker->items_count;
+}
+
+void
+get_begin_end_histograms_item_indexes( const struct histogram_worker* worker, int *first_item_index, int *end_item_index ){
+	int begin_detail_index = worker->helper.begin_detailed_histogram_index;
+	int begin_index = worker->helper.begin_histogram_index;
+	if ( worker->detailed_histogram.array )	{
+		int min1 = detailed_histogram_item_index( worker, begin_detail_index );
+		if ( worker->helper.begin_offset > 0 ){
+			min1 = min( worker->helper.begin_offset, min1 );
+		}
+		if ( begin_index != -1 ){
+			min1 = min( min1, big_histogram_item_index( worker, begin_index ) );
+		}
+		*first_item_index = min1;
+		*end_item_index = worker->detailed_histogram.array[worker->helper.end_detailed_histogram_index].item_index;
+		if ( worker->current_histogram_complete )
+			*end_item_index = *end_item_index+1;
+	}
+	else
+	{
+		if ( worker->helper.begin_offset > 0 ){
+			*first_item_index = min( worker->helper.begin_offset, big_histogram_item_index( worker, begin_index ) );
+		}
+		else
+			*first_item_index = big_histogram_item_index( worker, begin_index );
+		*end_item_index = big_histogram_item_index( worker, worker->helper.end_histogram_index );
+	}
+}
+
+/*Passing of big histogram item counts all items up to next one, some of it can be greater than
+ *splitter, so detailed histogram starts from last passed item but not before begin of range
+ *@return first item index of detailed histogram for worker on big histogram*/
+static int
+detailed_histogram_start_index( const struct histogram_worker* worker ){
+	int first_item_index, end_item_index;
+	get_begin_end_histograms_item_indexes( worker, &first_item_index, &end_item_index );
+	if ( !worker->helper.end_histogram_index )
+		return end_item_index;
+	return max( worker->histogram.array[ worker->helper.end_histogram_index-1 ].item_index, first_item_index );
+}
+
+
+/*@return items count of worker ranges processed for current destination*/
+int
+size_processed_histogram( const struct histogram_worker* worker ){
+	int begin_index = 0;
+	int end_index = 0;
+	get_begin_end_histograms_item_indexes( worker, &begin_index, &end_index );
+	return end_index - begin_index;
+}
+
+
+static int
+histogram_heap_less( struct histogram_worker* workers, int a, int b ){
+	SortKey a_item = value_at_cursor_histogram( &workers[a] )->item;
+	SortKey b_item = value_at_cursor_histogram( &workers[b] )->item;
+	return a_item < b_item || (a_item == b_item && a > b);
+}
+
+
+static void
+histogram_heap_swap( struct histogram_heap_t *heap, int i, int j ){
+	int worker = heap->workers[i];
+	heap->workers[i] = heap->workers[j];
+	heap->workers[j] = worker;
+	heap->positions[heap->workers[i]] = i;
+	heap->positions[heap->workers[j]] = j;
+}
+
+
+static void
+histogram_heap_sift_down( struct histogram_heap_t *heap, struct histogram_worker* workers, int i ){
+	for(;;){
+		int least = i;
+		for ( int child=2*i+1; child <= 2*i+2 && child < heap->count; child++ )
+			if ( histogram_heap_less( workers, heap->workers[child], heap->workers[least] ) )
+				least = child;
+		if ( least == i ) break;
+		histogram_heap_swap( heap, i, least );
+		i = least;
+	}
+}
+
+
+static void
+histogram_heap_sift( struct histogram_heap_t *heap, struct histogram_worker* workers, int i ){
+	while( i > 0 && histogram_heap_less( workers, heap->workers[i], heap->workers[(i-1)/2] ) ){
+		histogram_heap_swap( heap, i, (i-1)/2 );
+		i = (i-1)/2;
+	}
+	histogram_heap_sift_down( heap, workers, i );
+}
+
+
+/*Restore heap order after cursor of worker is changed, worker is removed if cursor is out of histograms*/
+static void
+histogram_heap_update( struct histogram_heap_t *heap, struct histogram_worker* workers, int worker ){
+	int i = heap->positions[worker];
+	if ( -1 == i ){
+		if ( !value_at_cursor_histogram( &workers[worker] ) ) return;
+		i = heap->positions[worker] = heap->count;
+		heap->workers[heap->count++] = worker;
+	}
+	if ( !value_at_cursor_histogram( &workers[worker] ) ){
+		heap->positions[worker] = -1;
+		if ( i != --heap->count ){
+			heap->workers[i] = heap->workers[heap->count];
+			heap->positions[heap->workers[i]] = i;
+			histogram_heap_sift( heap, workers, i );
+		}
+	}
+	else
+		histogram_heap_sift( heap, workers, i );
+}
+
+
+static void
+histogram_heap_build( struct histogram_heap_t *heap, struct histogram_worker* workers, int len ){
+	heap->count = 0;
+	for ( int i=0; i < len; i++ ){
+		heap->positions[i] = -1;
+		if ( value_at_cursor_histogram( &workers[i] ) ){
+			heap->positions[i] = heap->count;
+			heap->workers[heap->count++] = i;
+		}
+	}
+	for ( int i=heap->count/2-1; i >= 0; i-- )
+		histogram_heap_sift_down( heap, workers, i );
+}
+
+
+static void
+workers_list_add( struct workers_list_t *list, int worker ){
+	if ( list->marked[worker] ) return;
+	list->marked[worker] = 1;
+	list->workers[list->count++] = worker;
+}
+
+
+static void
+workers_list_add_all( struct workers_list_t *list, int len ){
+	for ( int i=0; i < len; i++ )
+		workers_list_add( list, i );
+}
+
+
+static void
+workers_list_clear( struct workers_list_t *list ){
+	for ( int i=0; i < list->count; i++ )
+		list->marked[list->workers[i]] = 0;
+	list->count = 0;
+}
+
+
+void
+print_request_data_array( struct request_data_t* const range, int len ){
+	for ( int j=0; j < len; j++ )
+	{
+		printf("SEQUENCE N:%d, dst_pid=%d, src_pid=%d, findex %d, lindex %d \n",
+				j, (int)range[j].dst_pid, (int)range[j].src_pid, range[j].first_item_index, range[j].last_item_index );
+	}
+}
+
+
+void
+init_helper_array( struct histogram_helper_t *range, int len ){
+	for ( int j=0; j < len; j++ ){
+		range[j].begin_histogram_index=0;
+		range[j].end_histogram_index=0;
+		range[j].begin_offset = 0;
+	}
+}
+
+void
+init_request_data_array( struct request_data_t *req_data, int len ){
+	for ( int j=0; j < len; j++ ){
+		req_data[j].src_pid = 0;
+		req_data[j].dst_pid = 0;
+		req_data[j].first_item_index = 0;
+		req_data[j].last_item_index = 0;
+	}
+}
+
+void
+request_assign_detailed_histogram( void *context, int current_histogram_len,
+		struct histogram_worker* workers, int array_len, int items_count, int last_request ){
+	pid_t pid = getpid();
+	struct request_data_t request_detailed_histogram[array_len];
+	for (int i=0; i < array_len; i++){
+		request_detailed_histogram[i].dst_pid = workers[i].histogram.src_pid;
+		request_detailed_histogram[i].src_pid = pid;
+		if ( workers[i].detailed_histogram.array ){
+			/*worker left behind in detailed histogram of previous range, it's requested again from begin
+			 *of current range up to the same length after cursor as for other workers*/
+			const struct histogram_worker *worker = &workers[i];
+			int begin_index = detailed_histogram_item_index( worker, worker->helper.begin_detailed_histogram_index );
+			int cursor_index = worker->detailed_histogram.array[worker->helper.end_detailed_histogram_index].item_index;
+			request_detailed_histogram[i].first_item_index = begin_index;
+			request_detailed_histogram[i].last_item_index =
+					min(cursor_index + current_histogram_len * array_len, items_count );
+			continue;
+		}
+		int start_index = detailed_histogram_start_index( &workers[i] );
+		request_detailed_histogram[i].first_item_index = start_index;
+		request_detailed_histogram[i].last_item_index =
+				min(start_index + current_histogram_len * array_len, items_count );
+#ifdef DEBUG
+		printf("\nWant %d range(%d, %d)\n",
+				request_detailed_histogram[i].dst_pid,
+				request_detailed_histogram[i].first_item_index,
+				request_detailed_histogram[i].last_item_index ); fflush(0);
+#endif
+	}
+
+	struct Histogram* detailed_histogram = channel_request_response_detailed_histograms_alloc_get_len(
+			context, request_detailed_histogram, array_len, last_request );
+	//save received detailed histograms into workers array
+	for ( int i=0; i < array_len; i++ ){
+		set_detailed_histogram( &workers[i], &detailed_histogram[i] );
+	}
+	/*free array memory, pointer data on cells is untouched
+	 *detailed_histogram items should be deleted after use*/
+	free(detailed_histogram); //free array cells, data on cells is un\touched
+
+}
+
+
+struct request_data_t**
+alloc_range_request_analize_histograms( void *context, int items_count,
+		const struct Histogram *histograms_array, size_t len, struct node_pid_t *child, int child_len ){
+	struct request_data_t **result = NULL;
+	struct histogram_worker workers[len];
+	for ( int i=0; i < len; i++ ){
+		workers[i].histogram = histograms_array[i];
+		init_worker(&workers[i]);
+		workers[i].processed_count = 0;
+		workers[i].items_count = items_count;
+	}
+	/*step of walk costs O(log len): minimum is taken from heap, check of detailed histograms removal
+	 *is done only for workers moved since last check, running items count is updated only by changed workers*/
+	int heap_workers[len], heap_positions[len];
+	struct histogram_heap_t heap = { 0, heap_workers, heap_positions };
+	histogram_heap_build( &heap, workers, len );
+	int check_workers[len], count_workers[len];
+	char check_marked[len], count_marked[len];
+	memset( check_marked, 0, len );
+	memset( count_marked, 0, len );
+	struct workers_list_t check_list = { 0, check_workers, check_marked }; /*check_remove_detailed_histogram needed*/
+	struct workers_list_t count_list = { 0, count_workers, count_marked }; /*processed_count is out of date*/
+	workers_list_add_all( &count_list, len );
+	int processed_total = 0;
+	int destination_index = 0;
+	int source_index_of_histogram = -1;
+	int allow_check_remove_detailed_hitogram = 0;
+	int failed = 0;
+	do{
+		int last_histograms_requested = 0;
+		int range_count = 0; /*items count processed for all destinations, max=items_count*len*/
+		if ( destination_index > 0 ){
+			for (int j=0; j < len; j++){
+				init_histogram( &workers[j] );
+			}
+			workers_list_add_all( &count_list, len );
+		}
+		while( range_count < items_count ){
+			/*in case when histogram item of big histogram is equal to item of detailed histogram
+			then now switch from detailed to big histogram */
+			/*Last requested detailed histograms should not be deleted to use it's data to completion of Analize*/
+			if ( !last_histograms_requested && allow_check_remove_detailed_hitogram ){
+				for (int i=0; i < check_list.count; i++){
+					int worker = check_list.workers[i];
+					if ( check_remove_detailed_histogram( &workers[worker] ) ){
+						histogram_heap_update( &heap, workers, worker );
+						workers_list_add( &count_list, worker );
+					}
+				}
+				workers_list_clear( &check_list );
+			}
+
+			/*histogram having minimal item at cursor*/
+			source_index_of_histogram = heap.count ? heap.workers[0] : -1;
+			if ( -1 == source_index_of_histogram ){
+				/*all cursors are out of histograms before partition is complete, last partition takes rest*/
+				failed = destination_index+1 < len;
+				break;
+			}
+			set_next_histogram( &workers[source_index_of_histogram] ); /*move cursor to next histogram*/
+			histogram_heap_update( &heap, workers, source_index_of_histogram );
+			workers_list_add( &check_list, source_index_of_histogram );
+			workers_list_add( &count_list, source_index_of_histogram );
+			for (int i=0; i < count_list.count; i++){
+				struct histogram_worker* worker = &workers[count_list.workers[i]];
+				int processed_count = size_processed_histogram( worker );
+				processed_total += processed_count - worker->processed_count;
+				worker->processed_count = processed_count;
+			}
+			workers_list_clear( &count_list );
+			range_count = processed_total;
+
+			//if up to end of items_count range less than len histograms
+			//so request histograms with step=1
+			int histogram_len = length_current_histogram( &workers[source_index_of_histogram] );
+			if ( !workers[source_index_of_histogram].detailed_histogram.array && !last_histograms_requested &&
+				 range_count + len*histogram_len >= items_count)
+			{
+				last_histograms_requested = destination_index+1 >= len;
+				printf("\r#%d Detailed Histograms recv start\n", destination_index );fflush(0);
+				request_assign_detailed_histogram( context, histogram_len, workers, len, items_count,
+						last_histograms_requested );
+				printf("\r#%d Detailed Histograms received\n", destination_index );fflush(0);
+				allow_check_remove_detailed_hitogram = 0;
+				/*cursors of all workers are switched to detailed histograms*/
+				histogram_heap_build( &heap, workers, len );
+				workers_list_add_all( &check_list, len );
+				workers_list_add_all( &count_list, len );
+			}
+		} //while
+		if ( failed ) break;
+		/*save range data based on histograms*/
+		if ( !result )
+			result = malloc( sizeof(struct request_data_t*)*len ); /*alloc memory for pointers*/
+		result[destination_index] = malloc( sizeof(struct request_data_t)*len ); /*alloc memory for one-dimension array*/
+		/*save results*/
+		for (int j=0; j < len; j++){
+			int first_item_index = 0;
+			int last_item_index = 0;
+			get_begin_end_histograms_item_indexes( &workers[j], &first_item_index, &last_item_index );
+			if ( destination_index+1 == len )
+				last_item_index = items_count; /*last partition takes rest of every source*/
+			result[destination_index][j].first_item_index = first_item_index;
+			result[destination_index][j].last_item_index = last_item_index-1;
+			result[destination_index][j].src_pid = workers[j].histogram.src_pid;
+			for (int k=0; k < child_len; k++)
+				if ( histograms_array[j].src_pid == child[k].src_node_pid  )
+				{
+					result[destination_index][j].dst_pid = child[k].dst_node_pid;
+				}
+		}
+
+		allow_check_remove_detailed_hitogram = 1;
+		destination_index++;
+	}while( destination_index < len );
+
+	for ( int i=0; i < len; i++ ){
+		free(workers[i].detailed_histogram.array);
+	}
+	if ( failed ){
+		for ( int d=0; d < destination_index; d++ )
+			free( result[d] );
+		free( result );
+		result = NULL;
+	}
+
+	return result;
+}
+
+
+int
+key_splitter_comparator( const void *m1, const void *m2 ){
+	const struct key_splitter_t *s1 = m1;
+	const struct key_splitter_t *s2 = m2;
+	if ( s1->key != s2->key )
+		return s1->key < s2->key ? -1 : 1;
+	if ( s1->src_pid != s2->src_pid )
+		return s1->src_pid < s2->src_pid ? -1 : 1;
+	return s1->item_index < s2->item_index ? -1 : s1->item_index > s2->item_index;
+}
+
+
+/**Sampling splitters mode: samples of all sources are sorted together by composite key and
+ * splitter i is sample at rank (i+1)*samples_count/len, as splitters of string mode
+ * @param splitters len-1 splitters, destinations count is equal to sources count,
+ * partition i gets items less than splitters[i]*/
+void
+sampling_splitters( const struct Histogram *histograms, int len, struct key_splitter_t *splitters ){
+	int samples_count = 0;
+	for ( int i=0; i < len; i++ )
+		samples_count += histograms[i].array_len;
+	struct key_splitter_t *samples = malloc( sizeof(struct key_splitter_t)*samples_count );
+	for ( int i=0, j=0; i < len; i++ )
+		for ( int k=0; k < histograms[i].array_len; k++, j++ ){
+			samples[j].key = histograms[i].array[k].item;
+			samples[j].src_pid = histograms[i].src_pid;
+			samples[j].item_index = histograms[i].array[k].item_index;
+		}
+	qsort( samples, samples_count, sizeof(struct key_splitter_t), key_splitter_comparator );
+	for ( int i=0; i < len-1; i++ )
+		splitters[i] = samples[ min( (i+1)*samples_count/len, samples_count-1 ) ];
+	free( samples );
+}
+
+
+/*@param pid source of sorted array
+ *@return index of first item of sorted array not less than splitter by composite key*/
+int
+key_splitter_cut( const BigArrayPtr sorted_array, int array_len, pid_t pid, const struct key_splitter_t *splitter ){
+	if ( pid < splitter->src_pid )
+		return array_upper_bound( sorted_array, array_len, splitter->key );
+	else if ( pid == splitter->src_pid )
+		return splitter->item_index;
+	else
+		return array_lower_bound( sorted_array, array_len, splitter->key );
+}
+
+
+/**Source cuts own sorted array by composite splitters
+ * @param src_pid source of sorted array
+ * @param sequence ranges of sorted array for every destination, len is destinations count*/
+void
+key_splitters_get_ranges( const BigArrayPtr sorted_array, int array_len, pid_t src_pid,
+		const struct key_splitter_t *splitters, const pid_t *dst_pids, struct request_data_t* sequence, int len ){
+	int first = 0;
+	for ( int i=0; i < len; i++ ){
+		int end = i < len-1 ? key_splitter_cut( sorted_array, array_len, src_pid, &splitters[i] ) : array_len;
+		sequence[i].first_item_index = first;
+		sequence[i].last_item_index = end-1;
+		sequence[i].src_pid = src_pid;
+		sequence[i].dst_pid = dst_pids[i];
+		first = end;
+	}
+}
+
+
+static double
+splitter_time_seconds(){
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+/*Sample of coarse histogram, samples of all sources are swept together by ascending keys*/
+struct rank_sample_t{
+	SortKey key;
+	int source;
+	int index;
+};
+
+static int
+rank_sample_comparator( const void *m1, const void *m2 ){
+	const struct rank_sample_t *s1 = m1;
+	const struct rank_sample_t *s2 = m2;
+	if ( s1->key != s2->key )
+		return s1->key < s2->key ? -1 : 1;
+	if ( s1->source != s2->source )
+		return s1->source < s2->source ? -1 : 1;
+	return s1->index < s2->index ? -1 : s1->index > s2->index;
+}
+
+
+/**Brackets of least keys having global ranks items not greater than it, estimated by coarse histograms:
+ * for every sampled key items count not greater than it is between index of last sample not greater
+ * than key and index of first sample greater than key. Both counts are growing with key, so samples of
+ * all sources are swept once and bracket of every rank is found by binary search of swept counts.
+ * @param low, high output, searched key of ranks[r] is in [low[r], high[r]]*/
+void
+histograms_rank_brackets( const struct Histogram *histograms, int len, int items_count,
+		const long long *ranks, int ranks_count, SortKey *low, SortKey *high ){
+	int samples_count = 0;
+	for ( int s=0; s < len; s++ )
+		samples_count += histograms[s].array_len;
+	struct rank_sample_t *samples = malloc( sizeof(struct rank_sample_t)*max( samples_count, 1 ) );
+	for ( int s=0, j=0; s < len; s++ )
+		for ( int k=0; k < histograms[s].array_len; k++, j++ ){
+			samples[j].key = histograms[s].array[k].item;
+			samples[j].source = s;
+			samples[j].index = k;
+		}
+	qsort( samples, samples_count, sizeof(struct rank_sample_t), rank_sample_comparator );
+
+	/*keys[g] - key of group g of equal samples, counts_min[g], counts_max[g] - bracket of items count
+	 *not greater than it*/
+	SortKey *keys = malloc( sizeof(SortKey)*max( samples_count, 1 ) );
+	long long *counts_min = malloc( sizeof(long long)*max( samples_count, 1 ) );
+	long long *counts_max = malloc( sizeof(long long)*max( samples_count, 1 ) );
+	long long count_min = 0, count_max = 0;
+	for ( int s=0; s < len; s++ )
+		count_max += histograms[s].array_len ? histograms[s].array[0].item_index : items_count;
+	int groups_count = 0;
+	for ( int i=0; i < samples_count; i++ ){
+		const struct Histogram *histogram = &histograms[samples[i].source];
+		const int k = samples[i].index;
+		/*samples of source not greater than key are k+1 instead of k*/
+		count_min += histogram->array[k].item_index+1 - (k ? histogram->array[k-1].item_index+1 : 0);
+		count_max += (k+1 < histogram->array_len ? histogram->array[k+1].item_index : items_count)
+				- histogram->array[k].item_index;
+		if ( i+1 == samples_count || samples[i+1].key != samples[i].key ){
+			keys[groups_count] = samples[i].key;
+			counts_min[groups_count] = count_min;
+			counts_max[groups_count++] = count_max;
+		}
+	}
+	free( samples );
+
+	for ( int r=0; r < ranks_count; r++ ){
+		/*first group having count_min not less than rank*/
+		int first = 0, count = groups_count;
+		while( count > 0 ){
+			int half = count/2;
+			if ( counts_min[first+half] < ranks[r] ){
+				first += half+1;
+				count -= half+1;
+			}
+			else
+				count = half;
+		}
+		high[r] = first < groups_count ? keys[first] : ~(SortKey)0;
+		/*group before first group having count_max not less than rank*/
+		first = 0, count = groups_count;
+		while( count > 0 ){
+			int half = count/2;
+			if ( counts_max[first+half] < ranks[r] ){
+				first += half+1;
+				count -= half+1;
+			}
+			else
+				count = half;
+		}
+		low[r] = first ? keys[first-1]+1 : 0;
+	}
+	free( keys );
+	free( counts_min );
+	free( counts_max );
+}
+
+
+/**@param cuts cuts[d*len+s] - items count of source s going to destinations [0..d]
+ * @return range requests table in layout of alloc_range_request_analize_histograms*/
+static struct request_data_t**
+alloc_range_request_from_cuts( const int *cuts, const pid_t *src_pids, int len,
+		const struct node_pid_t *child, int child_len ){
+	struct request_data_t **result = malloc( sizeof(struct request_data_t*)*len );
+	for ( int d=0; d < len; d++ ){
+		result[d] = malloc( sizeof(struct request_data_t)*len );
+		for ( int s=0; s < len; s++ ){
+			result[d][s].first_item_index = d ? cuts[(d-1)*len+s] : 0;
+			result[d][s].last_item_index = cuts[d*len+s]-1;
+			result[d][s].src_pid = src_pids[s];
+			for (int k=0; k < child_len; k++)
+				if ( src_pids[s] == child[k].src_node_pid )
+					result[d][s].dst_pid = child[k].dst_node_pid;
+		}
+	}
+	return result;
+}
+
+
+/**Splitters search by distributed bisection. Splitter of destination d is least key having
+ * (d+1)*items_count items not greater than it, all splitters are bisected together by rank
+ * queries of a few bytes, starting from brackets of coarse histograms. Items less than splitter
+ * go to destination, equal items are allocated by sources order.
+ * @return ranges array of the same layout as alloc_range_request_analize_histograms*/
+struct request_data_t**
+alloc_range_request_bisect_ranks( void *context, int items_count,
+		const struct Histogram *histograms_array, size_t len, struct node_pid_t *child, int child_len ){
+	const int splitters_count = len-1;
+	pid_t *src_pids = malloc( sizeof(pid_t)*len );
+	for ( int s=0; s < len; s++ )
+		src_pids[s] = histograms_array[s].src_pid;
+
+	long long *ranks = malloc( sizeof(long long)*len );
+	SortKey *low = malloc( sizeof(SortKey)*len );
+	SortKey *high = malloc( sizeof(SortKey)*len );
+	SortKey *pivots = malloc( sizeof(SortKey)*len );
+	struct rank_count_t *counts = malloc( sizeof(struct rank_count_t)*len*len );
+	for ( int d=0; d < splitters_count; d++ )
+		ranks[d] = (long long)(d+1)*items_count;
+	histograms_rank_brackets( histograms_array, len, items_count, ranks, splitters_count, low, high );
+	int rounds = 0;
+	int unresolved;
+	do{
+		unresolved = 0;
+		for ( int d=0; d < splitters_count; d++ ){
+			pivots[d] = low[d] + (high[d]-low[d])/2;
+			unresolved += low[d] < high[d];
+		}
+		/*last round queries found splitters to allocate equal items*/
+		channel_request_rank_counts( context, src_pids, len, pivots, splitters_count, !unresolved, counts, NULL );
+		++rounds;
+		for ( int d=0; d < splitters_count; d++ ){
+			long long count_le = 0;
+			for ( int s=0; s < len; s++ )
+				count_le += counts[s*splitters_count+d].less_equal;
+			if ( count_le >= ranks[d] )
+				high[d] = pivots[d];
+			else
+				low[d] = pivots[d]+1;
+		}
+	}while( unresolved );
+	printf("Rank bisection splitters found: rounds=%d, bytes per source=%d\n", rounds,
+			(int)(rounds*(sizeof(int)+splitters_count*(sizeof(SortKey)+sizeof(struct rank_count_t)))) );
+	fflush(0);
+
+	/*cuts[d*len+s] - items count of source s going to destinations [0..d]*/
+	int *cuts = malloc( sizeof(int)*len*len );
+	for ( int d=0; d < splitters_count; d++ ){
+		long long need = ranks[d];
+		for ( int s=0; s < len; s++ ){
+			cuts[d*len+s] = counts[s*splitters_count+d].less;
+			need -= cuts[d*len+s];
+		}
+		for ( int s=0; s < len; s++ ){
+			int taken = min( need, (long long)counts[s*splitters_count+d].less_equal - cuts[d*len+s] );
+			cuts[d*len+s] += taken;
+			need -= taken;
+		}
+	}
+	for ( int s=0; s < len; s++ )
+		cuts[splitters_count*len+s] = items_count;
+
+	struct request_data_t **result = alloc_range_request_from_cuts( cuts, src_pids, len, child, child_len );
+	free( cuts );
+	free( counts );
+	free( pivots );
+	free( high );
+	free( low );
+	free( ranks );
+	free( src_pids );
+	return result;
+}
+
+
+/**Bracket of items count of source less than key (less_equal=0) or not greater than key (less_equal=1),
+ * it's known by coarse histogram of source up to histogram step*/
+static void
+histogram_count_bracket( const struct Histogram *histogram, int items_count, SortKey key, int less_equal,
+		long long *count_min, long long *count_max ){
+	int first = 0, count = histogram->array_len;
+	while( count > 0 ){
+		int half = count/2;
+		SortKey item = histogram->array[first+half].item;
+		if ( item < key || (less_equal && item == key) ){
+			first += half+1;
+			count -= half+1;
+		}
+		else
+			count = half;
+	}
+	*count_min = first ? histogram->array[first-1].item_index+1 : 0;
+	*count_max = first < histogram->array_len ? histogram->array[first].item_index : items_count;
+}
+
+
+/*Bracket of global rank of composite splitter, it's items count less than splitter*/
+static void
+key_splitter_rank_bracket( const struct Histogram *histograms, int len, int items_count,
+		const struct key_splitter_t *splitter, long long *rank_min, long long *rank_max ){
+	*rank_min = *rank_max = 0;
+	for ( int s=0; s < len; s++ ){
+		long long count_min, count_max;
+		if ( histograms[s].src_pid == splitter->src_pid )
+			count_min = count_max = splitter->item_index;
+		else
+			histogram_count_bracket( &histograms[s], items_count, splitter->key,
+					histograms[s].src_pid < splitter->src_pid, &count_min, &count_max );
+		*rank_min += count_min;
+		*rank_max += count_max;
+	}
+}
+
+
+/**Epsilon balanced splitters: boundary d is cut on coarse histograms if it's rank is known within
+ * tolerance, rest boundaries are refined by rank queries bisection until tolerance is reached.
+ * Targets are cumulative, so errors of boundaries aren't accumulated.
+ * @param splitters len-1 splitters, partition i gets items less than splitters[i]*/
+void
+epsilon_key_splitters( void *context, int items_count, const struct Histogram *histograms, int len,
+		struct key_splitter_t *splitters ){
+	const int splitters_count = len-1;
+	/*every boundary within half of tolerance keeps partition within tolerance*/
+	const long long tolerance = (long long)(SPLITTER_EPSILON*items_count/2);
+	int samples_count = 0;
+	for ( int i=0; i < len; i++ )
+		samples_count += histograms[i].array_len;
+	struct key_splitter_t *samples = malloc( sizeof(struct key_splitter_t)*max( samples_count, 1 ) );
+	for ( int i=0, j=0; i < len; i++ )
+		for ( int k=0; k < histograms[i].array_len; k++, j++ ){
+			samples[j].key = histograms[i].array[k].item;
+			samples[j].src_pid = histograms[i].src_pid;
+			samples[j].item_index = histograms[i].array[k].item_index;
+		}
+	qsort( samples, samples_count, sizeof(struct key_splitter_t), key_splitter_comparator );
+
+	long long *ranks = malloc( sizeof(long long)*len );
+	int *resolved = malloc( sizeof(int)*len );
+	int refined_count = 0;
+	for ( int d=0; d < splitters_count; d++ ){
+		ranks[d] = (long long)(d+1)*items_count;
+		/*rank brackets are ascending by samples order, search first sample with middle of bracket
+		 *not less than target, it or previous sample is the nearest*/
+		int first = 0, count = samples_count;
+		while( count > 0 ){
+			int half = count/2;
+			long long rank_min, rank_max;
+			key_splitter_rank_bracket( histograms, len, items_count, &samples[first+half], &rank_min, &rank_max );
+			if ( rank_min + rank_max < 2*ranks[d] ){
+				first += half+1;
+				count -= half+1;
+			}
+			else
+				count = half;
+		}
+		resolved[d] = 0;
+		for ( int k=max( first-1, 0 ); k <= min( first, samples_count-1 ); k++ ){
+			long long rank_min, rank_max;
+			key_splitter_rank_bracket( histograms, len, items_count, &samples[k], &rank_min, &rank_max );
+			if ( ranks[d] - rank_min <= tolerance && rank_max - ranks[d] <= tolerance ){
+				splitters[d] = samples[k];
+				resolved[d] = 1;
+			}
+		}
+		refined_count += !resolved[d];
+	}
+	free( samples );
+
+	/*sources in pid order, it's order of equal keys of composite splitter*/
+	int *sources = malloc( sizeof(int)*len );
+	pid_t *src_pids = malloc( sizeof(pid_t)*len );
+	for ( int s=0; s < len; s++ ){
+		src_pids[s] = histograms[s].src_pid;
+		int j = s;
+		for ( ; j > 0 && histograms[sources[j-1]].src_pid > histograms[s].src_pid; j-- )
+			sources[j] = sources[j-1];
+		sources[j] = s;
+	}
+	SortKey *low = malloc( sizeof(SortKey)*len );
+	SortKey *high = malloc( sizeof(SortKey)*len );
+	SortKey *pivots = malloc( sizeof(SortKey)*len );
+	int *pivots_splitter = malloc( sizeof(int)*len );
+	struct rank_count_t *counts = malloc( sizeof(struct rank_count_t)*len*len );
+	/*brackets of refined boundaries are found together*/
+	long long *targets = malloc( sizeof(long long)*len );
+	SortKey *targets_low = malloc( sizeof(SortKey)*len );
+	SortKey *targets_high = malloc( sizeof(SortKey)*len );
+	int targets_count = 0;
+	for ( int d=0; d < splitters_count; d++ )
+		if ( !resolved[d] )
+			targets[targets_count++] = max( ranks[d] - tolerance, 1LL );
+	histograms_rank_brackets( histograms, len, items_count, targets, targets_count, targets_low, targets_high );
+	for ( int d=0, t=0; d < splitters_count; d++ )
+		if ( !resolved[d] ){
+			low[d] = targets_low[t];
+			high[d] = targets_high[t++];
+		}
+	free( targets );
+	free( targets_low );
+	free( targets_high );
+	int rounds = 0;
+	for(;;){
+		int pivots_count = 0;
+		for ( int d=0; d < splitters_count; d++ ){
+			if ( resolved[d] ) continue;
+			pivots_splitter[pivots_count] = d;
+			pivots[pivots_count++] = low[d] + (high[d]-low[d])/2;
+		}
+		/*request without pivots completes rank queries of sources*/
+		channel_request_rank_counts( context, src_pids, len, pivots, pivots_count, !pivots_count, counts, NULL );
+		if ( !pivots_count ) break;
+		++rounds;
+		for ( int p=0; p < pivots_count; p++ ){
+			const int d = pivots_splitter[p];
+			long long count_less = 0, count_le = 0;
+			for ( int s=0; s < len; s++ ){
+				count_less += counts[s*pivots_count+p].less;
+				count_le += counts[s*pivots_count+p].less_equal;
+			}
+			if ( count_le < ranks[d] - tolerance )
+				low[d] = pivots[p]+1;
+			else if ( count_less > ranks[d] + tolerance )
+				high[d] = pivots[p];
+			else{
+				/*equal items of pivot are taken in sources order up to nearest rank to target*/
+				long long need = min( max( ranks[d], count_less ), count_le ) - count_less;
+				for ( int j=0; j < len; j++ ){
+					const struct rank_count_t *count = &counts[sources[j]*pivots_count+p];
+					if ( need <= count->less_equal - count->less ){
+						splitters[d].key = pivots[p];
+						splitters[d].src_pid = histograms[sources[j]].src_pid;
+						splitters[d].item_index = count->less + need;
+						break;
+					}
+					need -= count->less_equal - count->less;
+				}
+				resolved[d] = 1;
+			}
+		}
+	}
+	printf("Epsilon splitters found: tolerance=%lld, refined boundaries=%d, rounds=%d\n",
+			2*tolerance, refined_count, rounds );
+	fflush(0);
+	free( counts );
+	free( pivots_splitter );
+	free( pivots );
+	free( high );
+	free( low );
+	free( src_pids );
+	free( sources );
+	free( resolved );
+	free( ranks );
+}
+
+
+/**Exact splitters by radix counts: every round sources count items of boundary bucket by next digit,
+ * manager prefix sums counts of all sources and narrows bucket of every boundary to digit holding
+ * target rank. Bucket of single key completes boundary, equal keys are shared in sources order.
+ * @return range requests table in layout of alloc_range_request_analize_histograms*/
+struct request_data_t**
+alloc_range_request_radix_counts( void *context, int items_count, struct node_pid_t *child, int len ){
+	const int splitters_count = len-1;
+	const int key_bits = sizeof(SortKey)*8;
+	pid_t *src_pids = malloc( sizeof(pid_t)*len );
+	for ( int s=0; s < len; s++ )
+		src_pids[s] = child[s].src_node_pid;
+
+	long long *ranks = malloc( sizeof(long long)*len );
+	struct radix_query_t *buckets = malloc( sizeof(struct radix_query_t)*len );
+	int *resolved = malloc( sizeof(int)*len );
+	/*cuts[d*len+s] - items count of source s going to destinations [0..d],
+	 *items count of source s less than bucket of unresolved boundary*/
+	int *cuts = malloc( sizeof(int)*len*len );
+	for ( int d=0; d < splitters_count; d++ ){
+		ranks[d] = (long long)(d+1)*items_count;
+		buckets[d].first_key = 0;
+		buckets[d].shift = key_bits - RADIX_SPLITTER_BITS;
+		resolved[d] = 0;
+		for ( int s=0; s < len; s++ )
+			cuts[d*len+s] = 0;
+	}
+	long long *total_counts = malloc( sizeof(long long)*RADIX_SPLITTER_BUCKETS );
+	struct radix_query_t *queries = malloc( sizeof(struct radix_query_t)*len );
+	int *queries_splitter = malloc( sizeof(int)*len );
+	/*answers are sparse, positions[s] - first count of source s not less than digit of boundary,
+	 *below_counts[s] - items count of source s less than that digit*/
+	int *positions = malloc( sizeof(int)*len );
+	int *below_counts = malloc( sizeof(int)*len );
+	int rounds = 0;
+	int complete = 0;
+	long long bytes = 0; /*received from all sources*/
+	double top_counts_time = 0; /*sources are sorted & top digit counts received*/
+	do{
+		int queries_count = 0;
+		complete = 1;
+		for ( int d=0; d < splitters_count; d++ ){
+			if ( resolved[d] ) continue;
+			/*first round query is the same for all boundaries*/
+			if ( !rounds && queries_count ) continue;
+			queries_splitter[queries_count] = d;
+			queries[queries_count++] = buckets[d];
+			/*bucket of single key is resolved by this round*/
+			complete &= !buckets[d].shift;
+		}
+		struct radix_counts_t *answers = channel_request_radix_counts_alloc( context, src_pids, len,
+				queries, queries_count, complete );
+		if ( !queries_count ) break;
+		++rounds;
+		if ( 1 == rounds )
+			top_counts_time = splitter_time_seconds();
+		for ( int q=0; q < queries_count; q++ ){
+			const struct radix_counts_t *answer = &answers[q*len];
+			memset( total_counts, 0, sizeof(long long)*RADIX_SPLITTER_BUCKETS );
+			for ( int s=0; s < len; s++ ){
+				for ( int j=0; j < answer[s].array_len; j++ )
+					total_counts[answer[s].array[j].digit] += answer[s].array[j].count;
+				bytes += sizeof(int) + (RADIX_COUNTS_DENSE(answer[s].array_len) ?
+						sizeof(int)*RADIX_SPLITTER_BUCKETS : sizeof(struct radix_count_t)*answer[s].array_len);
+				positions[s] = below_counts[s] = 0;
+			}
+			/*first round answers all boundaries, its digits are ascending as ranks*/
+			for ( int d=queries_splitter[q]; d < (rounds > 1 ? queries_splitter[q]+1 : splitters_count); d++ ){
+				long long below = 0;
+				for ( int s=0; s < len; s++ )
+					below += cuts[d*len+s];
+				int digit = 0;
+				while( below + total_counts[digit] < ranks[d] )
+					below += total_counts[digit++];
+				for ( int s=0; s < len; s++ ){
+					while( positions[s] < answer[s].array_len && answer[s].array[positions[s]].digit < digit )
+						below_counts[s] += answer[s].array[positions[s]++].count;
+					cuts[d*len+s] += below_counts[s];
+				}
+				buckets[d].first_key += (SortKey)digit << buckets[d].shift;
+				if ( buckets[d].shift && below + total_counts[digit] > ranks[d] ){
+					buckets[d].shift -= RADIX_SPLITTER_BITS;
+					continue;
+				}
+				/*digit is single key or whole digit fits to target, equal items are taken in sources order*/
+				long long need = ranks[d] - below;
+				for ( int s=0; s < len; s++ ){
+					int digit_count = positions[s] < answer[s].array_len &&
+							answer[s].array[positions[s]].digit == digit ? answer[s].array[positions[s]].count : 0;
+					int taken = min( need, (long long)digit_count );
+					cuts[d*len+s] += taken;
+					need -= taken;
+				}
+				resolved[d] = 1;
+			}
+		}
+		for ( int i=0; i < queries_count*len; i++ )
+			free( answers[i].array );
+		free( answers );
+	}while( !complete );
+	printf("Radix counts splitters found: rounds=%d, bytes per source=%d, time after top digit counts=%.3fs\n",
+			rounds, (int)(bytes/len), splitter_time_seconds() - top_counts_time );
+	fflush(0);
+	for ( int s=0; s < len; s++ )
+		cuts[splitters_count*len+s] = items_count;
+	struct request_data_t **result = alloc_range_request_from_cuts( cuts, src_pids, len, child, len );
+	free( below_counts );
+	free( positions );
+	free( queries_splitter );
+	free( queries );
+	free( total_counts );
+	free( cuts );
+	free( resolved );
+	free( buckets );
+	free( ranks );
+	free( src_pids );
+	return result;
+}
+
+
+/**Source: answer rank queries of pivots by binary search
+ * @param items item equal to every pivot, zeroed item if source has no such item, can be NULL*/
+void
+rank_query_counts( const BigArrayPtr sorted_array, int array_len, const SortKey *pivots, int pivots_count,
+		struct rank_count_t *counts, BigArrayItem *items ){
+	for ( int i=0; i < pivots_count; i++ ){
+		counts[i].less = array_lower_bound( sorted_array, array_len, pivots[i] );
+		counts[i].less_equal = array_upper_bound( sorted_array, array_len, pivots[i] );
+		if ( !items ) continue;
+		memset( &items[i], '\0', sizeof(BigArrayItem) );
+		if ( counts[i].less < counts[i].less_equal )
+			items[i] = sorted_array[counts[i].less];
+	}
+}
+
+
+/**Source: count items of bucket of radix query by digit, digits of sorted items are ascending
+ * so counts are taken by runs of equal digits
+ * @param counts output, counts of nonzero digits ascending by digit, buffer of RADIX_SPLITTER_BUCKETS counts
+ * @return count of nonzero digits*/
+int
+radix_query_counts( const BigArrayPtr sorted_array, int array_len, const struct radix_query_t *query,
+		struct radix_count_t *counts ){
+	const SortKey first_key = query->first_key;
+	const int shift = query->shift;
+	const SortKey last_key = first_key +
+			(((SortKey)(RADIX_SPLITTER_BUCKETS-1) << shift) | (((SortKey)1 << shift) - 1));
+	const int end = array_upper_bound( sorted_array, array_len, last_key );
+	int digits_count = 0;
+	for ( int i=array_lower_bound( sorted_array, array_len, first_key ); i < end; i++ ){
+		const int digit = (item_key( sorted_array[i] ) - first_key) >> shift;
+		if ( !digits_count || counts[digits_count-1].digit != digit ){
+			counts[digits_count].digit = digit;
+			counts[digits_count++].count = 0;
+		}
+		counts[digits_count-1].count++;
+	}
+	return digits_count;
+}
+
+
+/*@param dense output, RADIX_SPLITTER_BUCKETS counts*/
+void
+radix_counts_to_dense( const struct radix_count_t *sparse, int digits_count, int *dense ){
+	memset( dense, 0, sizeof(int)*RADIX_SPLITTER_BUCKETS );
+	for ( int j=0; j < digits_count; j++ )
+		dense[sparse[j].digit] = sparse[j].count;
+}
+
+
+/*@param sparse output, digits_count counts of nonzero digits*/
+void
+radix_counts_to_sparse( const int *dense, int digits_count, struct radix_count_t *sparse ){
+	int j = 0;
+	for ( int digit=0; digit < RADIX_SPLITTER_BUCKETS && j < digits_count; digit++ )
+		if ( dense[digit] ){
+			sparse[j].digit = digit;
+			sparse[j++].count = dense[digit];
+		}
+}
@@ -0,0 +1,178 @@
+/*
+ * splitter.h
+ *
+ *      Splitters search of manager that doesn't depend on transport: walk of sources histograms
+ *      completed by detailed histograms, composite key splitters of sampling modes, bisection & epsilon
+ *      splitters by rank queries and radix counts splitters; answers of sources to queries.
+ *      Detailed histograms are requested by channel_request_response_detailed_histograms_alloc_get_len,
+ *      rank & radix count queries by channel_request_rank_counts & channel_request_radix_counts_alloc,
+ *      it's implemented by zeromq channel of distributed sort & by in-memory sources of simulator.
+ */
+
+#ifndef SPLITTER_H_
+#define SPLITTER_H_
+
+#include "sort.h" //BigArrayPtr, HistogramArrayPtr
+#include <sys/types.h> //pid_t
+#include <stddef.h> //size_t
+
+#define max(a,b) \
+  ({ __typeof__ (a) _a = (a); \
+      __typeof__ (b) _b = (b); \
+    _a > _b ? _a : _b; })
+
+#define min(a,b) \
+  ({ __typeof__ (a) _a = (a); \
+      __typeof__ (b) _b = (b); \
+    _a < _b ? _a : _b; })
+
+/*Step of coarse histograms sent by sources for walk of histograms & rank queries splitters*/
+#define HISTOGRAM_STEP 1000
+/*Tolerance of epsilon splitters: partition is within +-SPLITTER_EPSILON*items_count items,
+ *0 gives exact partitions*/
+#define SPLITTER_EPSILON 0.01
+/*Digit width of radix counts splitters, SortKey bits should be multiple of it*/
+#define RADIX_SPLITTER_BITS 16
+#define RADIX_SPLITTER_BUCKETS (1<<RADIX_SPLITTER_BITS)
+/*Radix counts of bucket are sent dense if it has at least half of digits, else sparse*/
+#define RADIX_COUNTS_DENSE(digits_count) ((digits_count) >= RADIX_SPLITTER_BUCKETS/2)
+
+struct node_pid_t{
+	pid_t src_node_pid;
+	pid_t dst_node_pid;
+};
+
+struct Histogram{
+	pid_t src_pid;
+	size_t array_len;
+	HistogramArrayPtr array;
+};
+
+
+struct request_data_t{
+	int first_item_index;
+	int last_item_index;
+	pid_t src_pid;
+	pid_t dst_pid;
+};
+
+/*Answer of source to rank query of pivot*/
+struct rank_count_t{
+	int less; //count of items less than pivot
+	int less_equal; //count of items not greater than pivot
+};
+
+/*Radix count query: count items of bucket [first_key, first_key + 2^(shift+RADIX_SPLITTER_BITS)-1]
+ *by digit (key-first_key) >> shift*/
+struct radix_query_t{
+	SortKey first_key;
+	int shift;
+};
+
+/*Count of digit of sparse radix counts answer*/
+struct radix_count_t{
+	int digit;
+	int count;
+};
+
+/*Answer of source to radix count query, counts of nonzero digits ascending by digit*/
+struct radix_counts_t{
+	int array_len;
+	struct radix_count_t *array;
+};
+
+struct histogram_helper_t{
+	int begin_offset;
+	int begin_histogram_index; //First histogram in range
+	int end_histogram_index; //Last histogram in range
+	int begin_detailed_histogram_index; //First histogram in range
+	int end_detailed_histogram_index; //Last histogram in range
+};
+
+/*Splitter of sampling mode on composite key (key, source pid, item index): equal keys are ordered
+ *by source & position, so run of duplicates can be cut between destinations*/
+struct key_splitter_t{
+	SortKey key;
+	pid_t src_pid;
+	int item_index;
+};
+
+struct histogram_worker{
+	struct Histogram histogram;
+	struct Histogram detailed_histogram;
+	struct histogram_helper_t helper;
+	int current_histogram_complete;
+	int processed_count; //cached items count processed by worker, it's part of running total
+	int items_count; //items count of source, it's item index of cursor passed last item of big histogram
+};
+
+/*Min-heap of workers by item at cursor, walk of histograms takes top worker every step.
+ *Equal items are ordered by higher worker index first, as the walk always did*/
+struct histogram_heap_t{
+	int count;
+	int *workers; //heap of workers indexes
+	int *positions; //position of worker in heap, -1 if cursor of worker is out of histograms
+};
+
+/*Set of workers to be updated before next step of histograms walk*/
+struct workers_list_t{
+	int count;
+	int *workers;
+	char *marked;
+};
+
+
+/*@param complete Flag 0 say to client in request that would be requested again, 1-last request send
+ *return Histogram Caller is responsive to free memory after using result*/
+struct Histogram*
+channel_request_response_detailed_histograms_alloc_get_len(void *context, const struct request_data_t* request_data,
+		int request_array_len, int complete );
+
+/**Manager: send the same pivots to all sources & receive its counts, sources are working in parallel
+ * @param complete 1-last request, sources stop answering queries & answer it by items too
+ * @param counts output, counts[s*pivots_count+i] is answer of source s for pivot i
+ * @param items output of complete request, items[s*pivots_count+i] is item of source s equal to pivot i
+ * valid if its counts differ, can be NULL*/
+void
+channel_request_rank_counts( void *context, const pid_t *src_pids, int sources_count, const SortKey *pivots,
+		int pivots_count, int complete, struct rank_count_t *counts, BigArrayItem *items );
+
+/**Manager: send the same radix count queries to all sources & receive its counts
+ * @param complete 1-last request, sources stop answering queries
+ * @return answers[q*sources_count+s] of source s to query q, NULL if no queries,
+ * caller is responsive to free arrays of answers & returned array*/
+struct radix_counts_t*
+channel_request_radix_counts_alloc( void *context, const pid_t *src_pids, int sources_count,
+		const struct radix_query_t *queries, int queries_count, int complete );
+
+/**Walk of coarse & detailed histograms of all sources by ascending keys, partition is closed when
+ * items_count items are passed.
+ * @return range requests table, NULL if walk lost cursors of sources, e.g. by long runs of equal keys*/
+struct request_data_t**
+alloc_range_request_analize_histograms( void *context, int items_count,
+		const struct Histogram *histograms_array, size_t len, struct node_pid_t *child, int child_len );
+void histograms_rank_brackets( const struct Histogram *histograms, int len, int items_count,
+		const long long *ranks, int ranks_count, SortKey *low, SortKey *high );
+struct request_data_t**
+alloc_range_request_bisect_ranks( void *context, int items_count,
+		const struct Histogram *histograms_array, size_t len, struct node_pid_t *child, int child_len );
+void epsilon_key_splitters( void *context, int items_count, const struct Histogram *histograms, int len,
+		struct key_splitter_t *splitters );
+struct request_data_t**
+alloc_range_request_radix_counts( void *context, int items_count, struct node_pid_t *child, int len );
+void rank_query_counts( const BigArrayPtr sorted_array, int array_len, const SortKey *pivots, int pivots_count,
+		struct rank_count_t *counts, BigArrayItem *items );
+int radix_query_counts( const BigArrayPtr sorted_array, int array_len, const struct radix_query_t *query,
+		struct radix_count_t *counts );
+void radix_counts_to_dense( const struct radix_count_t *sparse, int digits_count, int *dense );
+void radix_counts_to_sparse( const int *dense, int digits_count, struct radix_count_t *sparse );
+void print_request_data_array( struct request_data_t* const range, int len );
+void init_request_data_array( struct request_data_t *req_data, int len );
+int key_splitter_comparator( const void *m1, const void *m2 );
+void sampling_splitters( const struct Histogram *histograms, int len, struct key_splitter_t *splitters );
+int key_splitter_cut( const BigArrayPtr sorted_array, int array_len, pid_t pid, const struct key_splitter_t *splitter );
+void key_splitters_get_ranges( const BigArrayPtr sorted_array, int array_len, pid_t src_pid,
+		const struct key_splitter_t *splitters, const pid_t *dst_pids, struct request_data_t* sequence, int len );
+
+
+#endif /* SPLITTER_H_ */
@@ -0,0 +1,423 @@
+/*
+ * string_sort.c
+ *
+ *      Local sort of packed byte strings by multikey quicksort over cached 8-byte prefixes:
+ *      partitioning compares one 64-bit integer per string instead of bytes, and strings are
+ *      touched again only when whole group shares the prefix, then next 8 bytes are loaded.
+ *      Sorted runs are merged by tournament tree of losers keeping common prefix length (LCP)
+ *      of every loser with the last merged string, so equal prefixes are not compared again.
+ */
+
+#include "string_sort.h"
+#include <stdlib.h>
+#include <stdio.h> //sprintf
+#include <string.h>
+#include <unistd.h> //getpid()
+
+/*Groups not longer than it are sorted by insertion sort*/
+#define STRING_INSERTION_SORT_LEN 16
+/*Bytes count of cached prefix*/
+#define STRING_PREFIX_LEN 8
+/*Initial bytes capacity of generated string per item*/
+#define STRING_RANDOM_CAPACITY 64
+
+
+/*Sorted string reference, prefix is 8 bytes of string starting from current depth*/
+struct string_ref_t{
+	uint64_t prefix;
+	uint32_t offset;
+	uint32_t len;
+};
+
+
+int
+string_compare( const char *a, uint32_t a_len, const char *b, uint32_t b_len ){
+	int res = memcmp( a, b, a_len < b_len ? a_len : b_len );
+	if ( res ) return res;
+	return a_len < b_len ? -1 : a_len > b_len;
+}
+
+
+static inline uint32_t
+common_prefix_len( const char *a, uint32_t a_len, const char *b, uint32_t b_len ){
+	uint32_t len = a_len < b_len ? a_len : b_len;
+	uint32_t i = 0;
+	while( i < len && a[i] == b[i] )
+		++i;
+	return i;
+}
+
+
+void
+string_array_alloc( struct string_array_t *array, int count, uint32_t bytes_size ){
+	array->count = count;
+	array->offsets = malloc( sizeof(uint32_t)*(count+1) );
+	array->lcps = malloc( sizeof(uint32_t)*(count+1) );
+	array->bytes = malloc( bytes_size+1 );
+	array->offsets[0] = 0;
+	array->offsets[count] = bytes_size;
+}
+
+
+void
+string_array_free( struct string_array_t *array ){
+	free( array->offsets );
+	free( array->lcps );
+	free( array->bytes );
+	array->offsets = array->lcps = NULL;
+	array->bytes = NULL;
+	array->count = 0;
+}
+
+
+/*Fill array by url-like strings, they have long common prefixes*/
+void
+alloc_string_array_fill_random( struct string_array_t *array, int count ){
+	static const char *words[] = { "index", "news", "sport", "api", "v1", "v2", "users", "items",
+			"search", "img", "static", "blog", "2012", "archive" };
+	const int words_count = sizeof(words)/sizeof(words[0]);
+	uint32_t capacity = count*STRING_RANDOM_CAPACITY;
+	uint32_t bytes_size = 0;
+	char *bytes = malloc( capacity );
+	array->count = count;
+	array->offsets = malloc( sizeof(uint32_t)*(count+1) );
+	array->lcps = NULL;
+
+	srand( getpid() );
+	for ( int i=0; i < count; i++ ){
+		char item[256];
+		int len = sprintf( item, "http://www.host%d.com", rand()%1000 );
+		for ( int j=rand()%4; j >= 0; j-- )
+			len += sprintf( item+len, "/%s", words[rand()%words_count] );
+		if ( rand()%2 )
+			len += sprintf( item+len, "?id=%d", rand() );
+		if ( bytes_size + len > capacity ){
+			capacity *= 2;
+			bytes = realloc( bytes, capacity );
+		}
+		array->offsets[i] = bytes_size;
+		memcpy( bytes+bytes_size, item, len );
+		bytes_size += len;
+	}
+	array->offsets[count] = bytes_size;
+	array->bytes = bytes;
+}
+
+
+/*@return 8 bytes of string starting from depth as big-endian number, short string padded by zeros*/
+static inline uint64_t
+load_prefix( const char *bytes, const struct string_ref_t *ref, uint32_t depth ){
+	const unsigned char *s = (const unsigned char*)bytes + ref->offset;
+	uint64_t prefix = 0;
+	for ( uint32_t i=depth; i < depth+STRING_PREFIX_LEN; i++ ){
+		prefix <<= 8;
+		if ( i < ref->len )
+			prefix |= s[i];
+	}
+	return prefix;
+}
+
+
+/*Strings of same group are equal up to depth, so compare it from depth*/
+static inline int
+string_ref_less( const char *bytes, const struct string_ref_t *a, const struct string_ref_t *b, uint32_t depth ){
+	if ( a->prefix != b->prefix )
+		return a->prefix < b->prefix;
+	return string_compare( bytes+a->offset+depth, a->len-depth, bytes+b->offset+depth, b->len-depth ) < 0;
+}
+
+
+static inline void
+swap_refs( struct string_ref_t *refs, int a, int b ){
+	struct string_ref_t swap = refs[a];
+	refs[a] = refs[b];
+	refs[b] = swap;
+}
+
+
+static void
+string_refs_insertion_sort( const char *bytes, struct string_ref_t *refs, int count, uint32_t depth ){
+	for ( int i=1; i < count; i++ ){
+		struct string_ref_t ref = refs[i];
+		int j = i;
+		for ( ; j > 0 && string_ref_less( bytes, &ref, &refs[j-1], depth ); j-- )
+			refs[j] = refs[j-1];
+		refs[j] = ref;
+	}
+}
+
+
+/*Strings ended inside of equal prefix are prefixes of each other, so order it by length.
+ *Lengths are in [depth, depth+8], it's partitioned by every length value in turn*/
+static void
+string_refs_sort_by_len( struct string_ref_t *refs, int count, uint32_t depth ){
+	int first = 0;
+	for ( uint32_t len=depth; len < depth+STRING_PREFIX_LEN && first < count; len++ ){
+		for ( int j=first; j < count; j++ ){
+			if ( refs[j].len == len )
+				swap_refs( refs, first++, j );
+		}
+	}
+}
+
+
+static inline uint64_t
+median_prefix( const struct string_ref_t *refs, int count ){
+	uint64_t a = refs[0].prefix, b = refs[count/2].prefix, c = refs[count-1].prefix;
+	if ( a < b )
+		return b < c ? b : (a < c ? c : a);
+	else
+		return a < c ? a : (b < c ? c : b);
+}
+
+
+/**Multikey quicksort: three-way partition by cached prefix, less & greater groups are sorted
+ * at the same depth, equal group continues from depth+8 with reloaded prefixes*/
+static void
+string_refs_sort( const char *bytes, struct string_ref_t *refs, int count, uint32_t depth ){
+	while( count > STRING_INSERTION_SORT_LEN ){
+		const uint64_t pivot = median_prefix( refs, count );
+		int lt = 0, i = 0, gt = count;
+		while( i < gt ){
+			if ( refs[i].prefix < pivot )
+				swap_refs( refs, lt++, i++ );
+			else if ( refs[i].prefix > pivot )
+				swap_refs( refs, i, --gt );
+			else
+				++i;
+		}
+		string_refs_sort( bytes, refs, lt, depth );
+		string_refs_sort( bytes, refs+gt, count-gt, depth );
+
+		/*equal group: strings ended inside of prefix go first*/
+		refs += lt;
+		count = gt - lt;
+		int ended = 0;
+		for ( int j=0; j < count; j++ ){
+			if ( refs[j].len <= depth+STRING_PREFIX_LEN )
+				swap_refs( refs, ended++, j );
+		}
+		string_refs_sort_by_len( refs, ended, depth );
+		refs += ended;
+		count -= ended;
+		depth += STRING_PREFIX_LEN;
+		for ( int j=0; j < count; j++ )
+			refs[j].prefix = load_prefix( bytes, &refs[j], depth );
+	}
+	string_refs_insertion_sort( bytes, refs, count, depth );
+}
+
+
+/**@param sorted_array output, allocated by function, it has lcps filled*/
+void
+string_sort( const struct string_array_t *array, struct string_array_t *sorted_array ){
+	const int count = array->count;
+	struct string_ref_t *refs = malloc( sizeof(struct string_ref_t)*(count+1) );
+	for ( int i=0; i < count; i++ ){
+		refs[i].offset = array->offsets[i];
+		refs[i].len = array->offsets[i+1] - array->offsets[i];
+		refs[i].prefix = load_prefix( array->bytes, &refs[i], 0 );
+	}
+	string_refs_sort( array->bytes, refs, count, 0 );
+
+	string_array_alloc( sorted_array, count, array->offsets[count] );
+	uint32_t bytes_size = 0;
+	for ( int i=0; i < count; i++ ){
+		const char *s = array->bytes + refs[i].offset;
+		sorted_array->offsets[i] = bytes_size;
+		sorted_array->lcps[i] = i ? common_prefix_len( s, refs[i].len,
+				array->bytes + refs[i-1].offset, refs[i-1].len ) : 0;
+		memcpy( sorted_array->bytes + bytes_size, s, refs[i].len );
+		bytes_size += refs[i].len;
+	}
+	free( refs );
+}
+
+
+/**Take every step string of sorted array, it's string analog of histogram*/
+void
+alloc_string_samples( const struct string_array_t *sorted_array, int step,
+		struct string_array_t *samples ){
+	int count = (sorted_array->count + step - 1) / step;
+	uint32_t bytes_size = 0;
+	for ( int i=0; i < sorted_array->count; i+=step )
+		bytes_size += sorted_array->offsets[i+1] - sorted_array->offsets[i];
+	string_array_alloc( samples, count, bytes_size );
+	bytes_size = 0;
+	for ( int i=0, j=0; i < sorted_array->count; i+=step, j++ ){
+		uint32_t len;
+		const char *s = string_at( sorted_array, i, &len );
+		samples->offsets[j] = bytes_size;
+		samples->lcps[j] = j ? common_prefix_len( s, len, samples->bytes + samples->offsets[j-1],
+				bytes_size - samples->offsets[j-1] ) : 0;
+		memcpy( samples->bytes+bytes_size, s, len );
+		bytes_size += len;
+	}
+}
+
+
+/**@return index of first string greater than key, strings equal to splitter go to lower range*/
+int
+string_upper_bound( const struct string_array_t *sorted_array, const char *key, uint32_t key_len ){
+	int first = 0, count = sorted_array->count;
+	while( count > 0 ){
+		int half = count/2;
+		uint32_t len;
+		const char *s = string_at( sorted_array, first+half, &len );
+		if ( string_compare( s, len, key, key_len ) <= 0 ){
+			first += half+1;
+			count -= half+1;
+		}
+		else
+			count = half;
+	}
+	return first;
+}
+
+
+/*LCP-aware tournament tree of losers, every loser keeps LCP with last merged string*/
+struct string_loser_tree_t{
+	const struct string_array_t *runs;
+	int *positions; //head string index of every run
+	int runs_count;
+	int *losers; //losers[0] is winner
+	uint32_t *lcps; //lcps[node] is LCP of losers[node] with last merged string
+};
+
+
+static inline int
+string_run_exhausted( const struct string_loser_tree_t *tree, int run ){
+	return run >= tree->runs_count || tree->positions[run] == tree->runs[run].count;
+}
+
+
+/**Play match of two runs which heads have LCP a_lcp, b_lcp with the same string,
+ * the run of larger LCP is less; for equal LCP heads are compared from it only.
+ * @param winner_lcp keeps LCP of winner, @param loser_lcp LCP of loser with winner*/
+static inline int
+string_loser_tree_match( const struct string_loser_tree_t *tree, int a, uint32_t a_lcp,
+		int b, uint32_t b_lcp, uint32_t *winner_lcp, uint32_t *loser_lcp ){
+	if ( string_run_exhausted( tree, a ) || string_run_exhausted( tree, b ) ){
+		int winner = string_run_exhausted( tree, a ) ? b : a;
+		*winner_lcp = winner == a ? a_lcp : b_lcp;
+		*loser_lcp = 0;
+		return winner;
+	}
+	if ( a_lcp != b_lcp ){
+		*winner_lcp = a_lcp > b_lcp ? a_lcp : b_lcp;
+		*loser_lcp = a_lcp > b_lcp ? b_lcp : a_lcp;
+		return a_lcp > b_lcp ? a : b;
+	}
+	uint32_t a_len, b_len;
+	const char *a_str = string_at( &tree->runs[a], tree->positions[a], &a_len );
+	const char *b_str = string_at( &tree->runs[b], tree->positions[b], &b_len );
+	uint32_t lcp = a_lcp + common_prefix_len( a_str+a_lcp, a_len-a_lcp, b_str+a_lcp, b_len-a_lcp );
+	*winner_lcp = a_lcp;
+	*loser_lcp = lcp;
+	/*equal strings are ordered by run index*/
+	int res = string_compare( a_str+lcp, a_len-lcp, b_str+lcp, b_len-lcp );
+	if ( res < 0 || (res == 0 && a < b) )
+		return a;
+	return b;
+}
+
+
+/**Merge sorted runs into merged_array allocated by function, lcps of runs are used if exist*/
+void
+string_multiway_merge( const struct string_array_t *runs, int runs_count,
+		struct string_array_t *merged_array ){
+	int count = 0;
+	uint32_t bytes_size = 0;
+	for ( int i=0; i < runs_count; i++ ){
+		count += runs[i].count;
+		bytes_size += runs[i].offsets[runs[i].count];
+	}
+	string_array_alloc( merged_array, count, bytes_size );
+
+	struct string_loser_tree_t tree;
+	int leaves_count = 1;
+	while( leaves_count < runs_count )
+		leaves_count *= 2;
+	tree.runs = runs;
+	tree.runs_count = runs_count;
+	tree.positions = calloc( leaves_count, sizeof(int) );
+	tree.losers = malloc( sizeof(int)*leaves_count );
+	tree.lcps = calloc( leaves_count, sizeof(uint32_t) );
+
+	/*initial tournament, LCP of all heads with empty string is 0*/
+	int winners[2*leaves_count];
+	uint32_t winners_lcps[2*leaves_count];
+	for ( int i=0; i < leaves_count; i++ ){
+		winners[leaves_count+i] = i;
+		winners_lcps[leaves_count+i] = 0;
+	}
+	for ( int node=leaves_count-1; node >= 1; node-- ){
+		int left = winners[2*node];
+		int right = winners[2*node+1];
+		winners[node] = string_loser_tree_match( &tree, left, winners_lcps[2*node], right, winners_lcps[2*node+1],
+				&winners_lcps[node], &tree.lcps[node] );
+		tree.losers[node] = winners[node] == left ? right : left;
+	}
+	int winner = winners[1];
+	uint32_t winner_lcp = winners_lcps[1];
+
+	bytes_size = 0;
+	for ( int i=0; i < count; i++ ){
+		uint32_t len;
+		const struct string_array_t *run = &runs[winner];
+		const char *s = string_at( run, tree.positions[winner], &len );
+		merged_array->offsets[i] = bytes_size;
+		merged_array->lcps[i] = i ? winner_lcp : 0;
+		memcpy( merged_array->bytes+bytes_size, s, len );
+		bytes_size += len;
+
+		/*next head of winner run, it's LCP with merged string is known from run*/
+		int position = ++tree.positions[winner];
+		uint32_t lcp = 0;
+		if ( position < run->count ){
+			uint32_t next_len;
+			const char *next = string_at( run, position, &next_len );
+			lcp = run->lcps ? run->lcps[position] : common_prefix_len( s, len, next, next_len );
+		}
+		/*replay matches to root, all losers on path have LCP with just merged string*/
+		for ( int node=(leaves_count+winner)/2; node >= 1; node/=2 ){
+			uint32_t node_winner_lcp, node_loser_lcp;
+			int loser = tree.losers[node];
+			int node_winner = string_loser_tree_match( &tree, winner, lcp, loser, tree.lcps[node],
+					&node_winner_lcp, &node_loser_lcp );
+			tree.losers[node] = node_winner == winner ? loser : winner;
+			tree.lcps[node] = node_loser_lcp;
+			winner = node_winner;
+			lcp = node_winner_lcp;
+		}
+		winner_lcp = lcp;
+	}
+
+	free( tree.positions );
+	free( tree.losers );
+	free( tree.lcps );
+}
+
+
+/*@return 1 if strings are sorted*/
+int
+test_string_sort_result( const struct string_array_t *array ){
+	for ( int i=1; i < array->count; i++ ){
+		uint32_t a_len, b_len;
+		const char *a = string_at( array, i-1, &a_len );
+		const char *b = string_at( array, i, &b_len );
+		if ( string_compare( a, a_len, b, b_len ) > 0 )
+			return 0;
+	}
+	return 1;
+}
+
+
+uint32_t
+string_array_crc( const struct string_array_t *array ){
+	uint32_t crc = 0;
+	const unsigned char *bytes = (const unsigned char*)array->bytes;
+	for ( uint32_t i=0; i < array->offsets[array->count]; i++ )
+		crc = (crc + bytes[i]) % 1000000;
+	return crc;
+}
@@ -0,0 +1,51 @@
+/*
+ * string_sort.h
+ *
+ *      Variable-length byte string keys. Strings are kept packed: bytes of all strings are
+ *      stored back to back & string i is bytes[offsets[i]..offsets[i+1]), so any range of
+ *      sorted strings is two contiguous blocks which can be sent as is.
+ */
+
+#ifndef STRING_SORT_H_
+#define STRING_SORT_H_
+
+#include <stdint.h> //uint32_t
+#include <stddef.h> //size_t
+
+
+struct string_array_t{
+	int count;
+	uint32_t *offsets; //count+1 offsets, offsets[count] is bytes size
+	uint32_t *lcps; //lcps[i] is common prefix length of strings i-1 & i, lcps[0]=0; NULL if unknown
+	char *bytes;
+};
+
+/*Packet header of string block sent by source node to destination*/
+struct string_block_header_t{
+	int count;
+	uint32_t bytes_size;
+};
+
+
+static inline const char*
+string_at( const struct string_array_t *array, int index, uint32_t *len ){
+	*len = array->offsets[index+1] - array->offsets[index];
+	return array->bytes + array->offsets[index];
+}
+
+/*@return strcmp like result, shorter string is less if it's prefix of longer one*/
+int string_compare( const char *a, uint32_t a_len, const char *b, uint32_t b_len );
+void string_array_alloc( struct string_array_t *array, int count, uint32_t bytes_size );
+void string_array_free( struct string_array_t *array );
+void alloc_string_array_fill_random( struct string_array_t *array, int count );
+void string_sort( const struct string_array_t *array, struct string_array_t *sorted_array );
+void alloc_string_samples( const struct string_array_t *sorted_array, int step,
+		struct string_array_t *samples );
+int string_upper_bound( const struct string_array_t *sorted_array, const char *key, uint32_t key_len );
+void string_multiway_merge( const struct string_array_t *runs, int runs_count,
+		struct string_array_t *merged_array );
+int test_string_sort_result( const struct string_array_t *array );
+uint32_t string_array_crc( const struct string_array_t *array );
+
+
+#endif /* STRING_SORT_H_ */